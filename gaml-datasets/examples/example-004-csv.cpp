@@ -0,0 +1,55 @@
+#include <gaml-datasets.hpp>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string_view>
+
+// The rows of the matrix are the samples. The first two columns are
+// the input, the last one is the label.
+using Row = gaml::datasets::csv::Matrix<double>::row_type;
+
+double input_of(const Row& row) {return row[0] + row[1];}
+int    label_of(const Row& row) {return (int)(row[2]);}
+
+int main(int argc, char* argv[]) {
+
+  std::random_device rd{};
+  std::mt19937 gen{rd()};
+
+  // Let us write a CSV file, with a header line.
+  {
+    std::ofstream outfile("samples.csv");
+    outfile << "x,y,class" << std::endl;
+    std::uniform_real_distribution<double> uniform(0, 1);
+    for(unsigned int i = 0; i < 1000; ++i) {
+      double x = uniform(gen);
+      double y = uniform(gen);
+      outfile << x << ',' << y << ',' << (x + y > 1 ? "\"high\"" : "\"low\"") << std::endl;
+    }
+  }
+
+  // The schema tells how the fields are read. The label is converted
+  // into a number.
+  auto schema = gaml::datasets::csv::schema<double>()
+    .numbers(0, 2)
+    .convert(2, [](std::string_view label) {return label == "high" ? 1. : 0.;});
+  auto data = gaml::datasets::csv::read("samples.csv", schema, ',', 1);
+  std::cout << data.rows() << " samples of " << data.cols() << " values read." << std::endl;
+
+  // The matrix is a random access collection of rows, so the set
+  // manipulations apply to it.
+  auto shuffled = gaml::shuffle(data.begin(), data.end(), gen);
+  std::cout << "First shuffled sample : " << input_of(*(shuffled.begin())) << " -> " << label_of(*(shuffled.begin())) << std::endl;
+
+  auto kfold = gaml::partition::KFold(shuffled.begin(), shuffled.end(), 5);
+  for(unsigned int fold = 0; fold < kfold.size(); ++fold) {
+    unsigned int nb_high = 0, nb_wrong = 0;
+    for(auto it = kfold.begin(fold); it != kfold.end(fold); ++it) {
+      nb_high  += label_of(*it);
+      nb_wrong += (input_of(*it) > 1) != (label_of(*it) == 1);
+    }
+    std::cout << "fold " << fold << " : " << std::distance(kfold.begin(fold), kfold.end(fold)) << " samples, "
+	      << nb_high << " high ones, " << nb_wrong << " inconsistent ones." << std::endl;
+  }
+  return 0;
+}
@@ -29,6 +29,7 @@
 #include "gamldatasetsArtificial.hpp"
 #include "gamldatasetsDownload.hpp"
 #include "gamldatasetsMNIST.hpp"
+#include "gamldatasetsCSV.hpp"
 
 /**
  * @example example-001-artificial.cpp
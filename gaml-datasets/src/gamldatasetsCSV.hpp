@@ -0,0 +1,435 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2022,  CentraleSupelec
+ *
+ *   Author : Hervé Frezza-Buet
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : herve.frezza-buet@centralesupelec.fr
+ *
+ */
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <span>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <charconv>
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+#include <gaml.hpp>
+
+namespace gaml {
+  namespace datasets {
+
+    /**
+     * This is a fast reader of numerical CSV files into matrices. The
+     * file is mapped in memory, split into chunks of whole lines, and
+     * the chunks are scanned in parallel. The values are parsed with
+     * std::from_chars and stored directly in a contiguous matrix.
+     */
+    namespace csv {
+
+      enum class Order {rows, columns};
+
+      /**
+       * This is a dense matrix, stored in a contiguous vector either
+       * row by row or column by column. A row-major matrix is a
+       * random access collection of rows (std::span<const T>), so
+       * that it can be used as a dataset, input_of and output_of
+       * selecting parts of a row.
+       */
+      template<typename T>
+      class Matrix {
+      private:
+	std::vector<T> values;
+	std::size_t    nb_rows;
+	std::size_t    nb_cols;
+	Order          order_;
+
+      public:
+	using value_type = T;
+	using row_type   = std::span<const T>;
+
+	Matrix() : values(), nb_rows(0), nb_cols(0), order_(Order::rows) {}
+	Matrix(std::size_t nb_rows, std::size_t nb_cols, Order order)
+	  : values(nb_rows * nb_cols), nb_rows(nb_rows), nb_cols(nb_cols), order_(order) {}
+	Matrix(const Matrix&)            = default;
+	Matrix(Matrix&&)                 = default;
+	Matrix& operator=(const Matrix&) = default;
+	Matrix& operator=(Matrix&&)      = default;
+
+	std::size_t rows()  const {return nb_rows;}
+	std::size_t cols()  const {return nb_cols;}
+	Order       order() const {return order_;}
+	T*          data()        {return values.data();}
+	const T*    data()  const {return values.data();}
+
+	T& operator()(std::size_t i, std::size_t j) {
+	  return values[order_ == Order::rows ? i * nb_cols + j : j * nb_rows + i];
+	}
+
+	const T& operator()(std::size_t i, std::size_t j) const {
+	  return values[order_ == Order::rows ? i * nb_cols + j : j * nb_rows + i];
+	}
+
+	row_type row(std::size_t i) const {
+	  if(order_ != Order::rows)
+	    throw std::logic_error("gaml::datasets::csv::Matrix::row : the matrix is column-major.");
+	  return row_type(values.data() + i * nb_cols, nb_cols);
+	}
+
+	row_type column(std::size_t j) const {
+	  if(order_ != Order::columns)
+	    throw std::logic_error("gaml::datasets::csv::Matrix::column : the matrix is row-major.");
+	  return row_type(values.data() + j * nb_rows, nb_rows);
+	}
+
+	class iterator {
+	public:
+	  using difference_type   = std::ptrdiff_t;
+	  using value_type        = row_type;
+	  using pointer           = const row_type*;
+	  using reference         = const row_type&;
+	  using iterator_category = std::random_access_iterator_tag;
+
+	private:
+	  const T*         first;
+	  std::size_t      nb_cols;
+	  std::ptrdiff_t   index;
+	  mutable row_type row; // The span of the last dereferenced row.
+
+	public:
+	  iterator() : first(nullptr), nb_cols(0), index(0), row() {}
+	  iterator(const T* first, std::size_t nb_cols, std::ptrdiff_t index) : first(first), nb_cols(nb_cols), index(index), row() {}
+
+	  const row_type& operator*() const            {row = row_type(first + index * nb_cols, nb_cols); return row;}
+	  row_type operator[](std::ptrdiff_t i) const  {return row_type(first + (index + i) * nb_cols, nb_cols);}
+
+	  iterator& operator++()                       {++index;    return *this;}
+	  iterator& operator--()                       {--index;    return *this;}
+	  iterator  operator++(int)                    {iterator it(*this); ++index; return it;}
+	  iterator  operator--(int)                    {iterator it(*this); --index; return it;}
+	  iterator& operator+=(std::ptrdiff_t i)       {index += i; return *this;}
+	  iterator& operator-=(std::ptrdiff_t i)       {index -= i; return *this;}
+	  iterator  operator+ (std::ptrdiff_t i) const {iterator it(*this); it += i; return it;}
+	  iterator  operator- (std::ptrdiff_t i) const {iterator it(*this); it -= i; return it;}
+
+	  std::ptrdiff_t operator-(const iterator& other) const {return index - other.index;}
+
+	  bool operator!=(const iterator& other) const {return index != other.index;}
+	  bool operator==(const iterator& other) const {return index == other.index;}
+	  bool operator< (const iterator& other) const {return index <  other.index;}
+	  bool operator> (const iterator& other) const {return index >  other.index;}
+	  bool operator<=(const iterator& other) const {return index <= other.index;}
+	  bool operator>=(const iterator& other) const {return index >= other.index;}
+	};
+
+	iterator begin() const {
+	  if(order_ != Order::rows)
+	    throw std::logic_error("gaml::datasets::csv::Matrix::begin : the matrix is column-major.");
+	  return iterator(values.data(), nb_cols, 0);
+	}
+
+	iterator end() const {
+	  if(order_ != Order::rows)
+	    throw std::logic_error("gaml::datasets::csv::Matrix::end : the matrix is column-major.");
+	  return iterator(values.data(), nb_cols, nb_rows);
+	}
+      };
+
+      /**
+       * A schema tells which fields of a line are read, and how. Each
+       * call adds a column to the matrix, in the order of the calls.
+       * The fields which are not in the schema are skipped without
+       * being parsed, as well as the end of the lines after the last
+       * field of the schema.
+       */
+      template<typename T>
+      class Schema {
+      public:
+	struct Column {
+	  std::size_t                          field;
+	  std::function<T (std::string_view)>  convert; // Empty for numbers.
+	};
+
+      private:
+	std::vector<Column> columns_;
+
+      public:
+	/**
+	 * The field is a number, parsed with std::from_chars.
+	 */
+	Schema& number(std::size_t field) {
+	  columns_.push_back({field, {}});
+	  return *this;
+	}
+
+	/**
+	 * The fields first, first+1, ... last-1 are numbers.
+	 */
+	Schema& numbers(std::size_t first, std::size_t last) {
+	  for(std::size_t field = first; field < last; ++field)
+	    number(field);
+	  return *this;
+	}
+
+	/**
+	 * The field is converted by convert(std::string_view) (e.g. a
+	 * label into a class index). The surrounding blanks and quotes
+	 * are removed.
+	 */
+	template<typename CONVERT>
+	Schema& convert(std::size_t field, const CONVERT& convert) {
+	  columns_.push_back({field, convert});
+	  return *this;
+	}
+
+	const std::vector<Column>& columns() const {return columns_;}
+      };
+
+      template<typename T = double>
+      Schema<T> schema() {
+	return Schema<T>();
+      }
+
+      namespace internal {
+
+	inline bool is_blank(char c) {
+	  return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline const char* next_line(const char* p, const char* end) {
+	  const char* q = (const char*)(std::memchr(p, '\n', end - p));
+	  return q == nullptr ? end : q + 1;
+	}
+
+	// The line end, without "\n" or "\r\n".
+	inline const char* line_end(const char* p, const char* end) {
+	  const char* q = (const char*)(std::memchr(p, '\n', end - p));
+	  if(q == nullptr) q = end;
+	  if(q != p && q[-1] == '\r') --q;
+	  return q;
+	}
+
+	inline bool is_empty(const char* p, const char* end) {
+	  while(p != end && is_blank(*p)) ++p;
+	  return p == end || *p == '\n';
+	}
+
+	inline std::runtime_error error(std::size_t row, std::size_t field, const std::string& what) {
+	  return std::runtime_error("gaml::datasets::csv::read : data row " + std::to_string(row)
+				    + ", field " + std::to_string(field) + " : " + what);
+	}
+
+	template<typename T>
+	class Scanner {
+	private:
+	  char                     sep;
+	  std::vector<int>         targets;    // The column of each field, -1 if skipped.
+	  std::vector<const std::function<T (std::string_view)>*> converters;
+
+	  // A tab separator is not a blank.
+	  bool blank(char c) const {
+	    return is_blank(c) && (sep == ' ' || c != sep);
+	  }
+
+	  void store(const char* b, const char* e, std::size_t row, std::size_t field, T* out) const {
+	    int col = targets[field];
+	    if(col < 0)
+	      return;
+	    if(converters[col] != nullptr) {
+	      out[col] = (*(converters[col]))(std::string_view(b, e - b));
+	      return;
+	    }
+	    if(b != e && *b == '+') ++b;
+	    T value;
+	    auto res = std::from_chars(b, e, value);
+	    if(b == e || res.ec != std::errc() || res.ptr != e)
+	      throw error(row, field, "\"" + std::string(b, e) + "\" is not a number");
+	    out[col] = value;
+	  }
+
+	public:
+	  Scanner(const Schema<T>& schema, char sep) : sep(sep), targets(), converters() {
+	    for(auto& column : schema.columns()) {
+	      if(column.field >= targets.size())
+		targets.resize(column.field + 1, -1);
+	      if(targets[column.field] >= 0)
+		throw std::runtime_error("gaml::datasets::csv::read : a field is read twice.");
+	      targets[column.field] = converters.size();
+	      converters.push_back(column.convert ? &(column.convert) : nullptr);
+	    }
+	  }
+
+	  /**
+	   * This counts the non empty lines of [p, end).
+	   */
+	  std::size_t count(const char* p, const char* end) const {
+	    std::size_t nb = 0;
+	    for(; p != end; p = next_line(p, end))
+	      if(!is_empty(p, end))
+		++nb;
+	    return nb;
+	  }
+
+	  /**
+	   * This parses the non empty lines of [p, end), the first one
+	   * being the data row row. The values of a row are written in
+	   * out, with a stride between columns, out being moved by
+	   * row_step for the next row.
+	   */
+	  void parse(const char* p, const char* end, std::size_t row,
+		     T* out, std::size_t stride, std::size_t row_step) const {
+	    std::vector<T> values(converters.size());
+	    for(; p != end; p = next_line(p, end)) {
+	      if(is_empty(p, end))
+		continue;
+	      const char* e = line_end(p, end);
+	      const char* q = p;
+	      for(std::size_t field = 0; field < targets.size(); ++field) {
+		while(q != e && blank(*q)) ++q;
+		if(field > 0) {
+		  if(sep != ' ') {
+		    if(q == e || *q != sep)
+		      throw error(row, field, std::string("separator '") + sep + "' expected");
+		    ++q;
+		    while(q != e && blank(*q)) ++q;
+		  }
+		  else if(q == e)
+		    throw error(row, field, "missing field");
+		}
+		const char* b;
+		const char* f;
+		if(q != e && *q == '"') {
+		  b = ++q;
+		  q = (const char*)(std::memchr(q, '"', e - q));
+		  if(q == nullptr)
+		    throw error(row, field, "unterminated quote");
+		  f = q++;
+		}
+		else {
+		  b = q;
+		  if(sep == ' ')
+		    while(q != e && !blank(*q)) ++q;
+		  else {
+		    q = (const char*)(std::memchr(q, sep, e - q));
+		    if(q == nullptr) q = e;
+		  }
+		  f = q;
+		  while(f != b && blank(f[-1])) --f;
+		}
+		store(b, f, row, field, values.data());
+	      }
+	      for(std::size_t col = 0; col < values.size(); ++col)
+		out[col * stride] = values[col];
+	      out += row_step;
+	      ++row;
+	    }
+	  }
+	};
+
+	template<typename JOB>
+	void run(unsigned int nb, const JOB& job) {
+	  if(nb == 1) {
+	    job(0);
+	    return;
+	  }
+	  std::vector<std::exception_ptr> errors(nb);
+	  std::vector<std::thread> workers;
+	  for(unsigned int k = 0; k < nb; ++k)
+	    workers.emplace_back([&job, &errors, k]() {
+		try {
+		  job(k);
+		}
+		catch(...) {
+		  errors[k] = std::current_exception();
+		}
+	      });
+	  for(auto& worker : workers)
+	    worker.join();
+	  for(auto& error : errors)
+	    if(error)
+	      std::rethrow_exception(error);
+	}
+      }
+
+      /**
+       * This reads the CSV data in [begin, end).
+       * @param schema The fields to be read.
+       * @param sep The field separator. With ' ', fields are separated by any run of blanks.
+       * @param skiprows The number of lines to skip at the beginning (headers).
+       * @param order The storage order of the matrix.
+       * @param nb_threads The number of scanning threads.
+       * @return The matrix, with one row per non empty line.
+       */
+      template<typename T>
+      Matrix<T> read(const char* begin, const char* end, const Schema<T>& schema,
+		     char sep = ',', unsigned int skiprows = 0, Order order = Order::rows,
+		     unsigned int nb_threads = std::thread::hardware_concurrency()) {
+	internal::Scanner<T> scanner(schema, sep);
+	for(unsigned int r = 0; r < skiprows && begin != end; ++r)
+	  begin = internal::next_line(begin, end);
+
+	// The chunks start at the beginning of lines.
+	const std::size_t min_chunk_size = 1 << 20;
+	std::size_t size = end - begin;
+	unsigned int nb_chunks = std::max<std::size_t>(1, std::min<std::size_t>(std::max(1u, nb_threads), size / min_chunk_size));
+	std::vector<const char*> starts(nb_chunks + 1);
+	starts[0]         = begin;
+	starts[nb_chunks] = end;
+	for(unsigned int k = 1; k < nb_chunks; ++k)
+	  starts[k] = std::max(internal::next_line(begin + size * k / nb_chunks - 1, end), starts[k-1]);
+
+	std::vector<std::size_t> first_rows(nb_chunks + 1, 0);
+	internal::run(nb_chunks, [&](unsigned int k) {first_rows[k+1] = scanner.count(starts[k], starts[k+1]);});
+	for(unsigned int k = 0; k < nb_chunks; ++k)
+	  first_rows[k+1] += first_rows[k];
+
+	std::size_t nb_rows = first_rows[nb_chunks];
+	std::size_t nb_cols = schema.columns().size();
+	Matrix<T> matrix(nb_rows, nb_cols, order);
+	std::size_t stride   = order == Order::rows ? 1       : nb_rows;
+	std::size_t row_step = order == Order::rows ? nb_cols : 1;
+	internal::run(nb_chunks, [&](unsigned int k) {
+	    scanner.parse(starts[k], starts[k+1], first_rows[k],
+			  matrix.data() + first_rows[k] * row_step, stride, row_step);
+	  });
+	return matrix;
+      }
+
+      /**
+       * This reads a CSV file, see the other read function.
+       */
+      template<typename T>
+      Matrix<T> read(const std::string& path, const Schema<T>& schema,
+		     char sep = ',', unsigned int skiprows = 0, Order order = Order::rows,
+		     unsigned int nb_threads = std::thread::hardware_concurrency()) {
+	gaml::MappedFile file(path);
+	return read(file.begin(), file.end(), schema, sep, skiprows, order, nb_threads);
+      }
+    }
+  }
+}
@@ -142,6 +142,12 @@ namespace gaml {
 	return !is.eof();
       }
 
+      bool resync(std::istream& is) const {
+	// Each data stands on its own line.
+	is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+	return readSeparator(is);
+      }
+
       void write(std::ostream& os, const value_type& data) const {
 	for(const auto& v: data.first)
 	  os << v << ", ";
@@ -44,6 +44,7 @@ namespace gaml {
  
       struct InputParser : public gaml::BasicParser {
 	using value_type = input;
+	static constexpr std::size_t record_size = sizeof(input);
   
 	void writeBegin(std::ostream& os) const {}
 	void writeEnd(std::ostream& os) const {}
@@ -66,6 +67,7 @@ namespace gaml {
  
       struct LabelParser : public gaml::BasicParser {
 	using value_type = label;
+	static constexpr std::size_t record_size = sizeof(label);
   
 	void writeBegin(std::ostream& os) const {}
 	void writeEnd(std::ostream& os) const {}
@@ -121,6 +123,8 @@ namespace gaml {
 	dataset& operator=(dataset&&)       = default;
 
 	/**
+	 * The records have a fixed size, so the idx files are neither
+	 * built nor read.
 	 * @param input_files : (input_data_filename, input_idx_filename).
 	 * @param label_files : (label_data_filename, label_idx_filename).
 	 */
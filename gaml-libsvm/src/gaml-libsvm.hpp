@@ -261,6 +261,29 @@ namespace gaml {
 	}
       }
 
+      /**
+       * The predictor is checked once for the whole batch, and the
+       * nodes are converted in a buffer of the call, which only grows
+       * as needed. Unlike operator(), this call is thread-safe.
+       */
+      template<typename InputIterator, typename OutputIterator>
+      void predict_batch(const InputIterator& begin, const InputIterator& end, OutputIterator out) const {
+	if(!(*this))
+	  throw gaml::libsvm::exception::BadPredictor(model ==  0,
+						      nb_nodes_of == nullptr,
+						      nodes_of == nullptr,
+						      from_double == nullptr);
+	std::vector<struct svm_node> buffer;
+	for(InputIterator it = begin; it != end; ++it) {
+	  const auto& x = *it;
+	  std::size_t nb = nb_nodes_of(x);
+	  if(buffer.size() < nb)
+	    buffer.resize(nb);
+	  nodes_of(x, buffer.data());
+	  *(out++) = from_double(predict(buffer.data()));
+	}
+      }
+
       /** This encapsulates svm_predict of libsvm. */
       double predict(const struct svm_node* x) const {return svm_predict(model.get(),x);}
       /** This encapsulates svm_get_svm_type of libsvm. */
@@ -4,6 +4,8 @@
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_blas.h>
 #include <map>
+#include <vector>
+#include <memory>
 
 namespace gaml {
   namespace linear {
@@ -60,6 +62,34 @@ namespace gaml {
 
 	return y + offset_output;
       }
+
+      /**
+       * The non null weights are gathered once in contiguous arrays
+       * for the whole batch. The features are computed in a buffer
+       * of the call, so that several threads can predict at once.
+       */
+      template<typename InputIterator, typename OutputIterator>
+      void predict_batch(const InputIterator& begin, const InputIterator& end, OutputIterator out) const {
+	std::vector<unsigned int> indices;
+	std::vector<double>       weights;
+	indices.reserve(w.size());
+	weights.reserve(w.size());
+	for(auto& kv: w) {
+	  indices.push_back(kv.first);
+	  weights.push_back(kv.second);
+	}
+
+	std::unique_ptr<gsl_vector, decltype(&gsl_vector_free)> features(gsl_vector_alloc(phix->size), gsl_vector_free);
+	const double* f = features->data;
+	std::size_t f_stride = features->stride;
+	for(InputIterator it = begin; it != end; ++it) {
+	  phi(features.get(), *it);
+	  double y = 0;
+	  for(unsigned int i = 0; i < indices.size(); ++i)
+	    y += f[indices[i] * f_stride] * weights[i];
+	  *(out++) = y + offset_output;
+	}
+      }
   
     };
 
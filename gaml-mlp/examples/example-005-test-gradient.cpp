@@ -89,6 +89,10 @@ int main(int argc, char* argv[]) {
 
   unsigned int nbtrials = 100;
   unsigned int nbfails = 0;
+  unsigned int nbfails_backward = 0;
+  gaml::mlp::values_type deltas(mlp.size());
+  gaml::mlp::values_type scratch(3 * mlp.size());
+  gaml::mlp::parameters_type backward_derivatives(mlp.psize());
   std::cout << "I will compare " << nbtrials << " times a numerical approximation and the analytical gradient we compute" << std::endl;
 
 
@@ -152,6 +156,25 @@ int main(int argc, char* argv[]) {
     if(error > 1e-7) 
       ++nbfails;
 
+    // The gradient computed with a single backward sweep
+    // must match the one computed parameter per parameter
+    std::fill(backward_derivatives.begin(), backward_derivatives.end(), 0.0);
+    if(quadratic_loss)
+      loss_quadratic.output_deriv(raw_target, forward_sweep, deltas.end() - OUTPUT_DIM);
+    else
+      loss_ce.output_deriv(raw_target, forward_sweep, deltas.end() - OUTPUT_DIM);
+    mlp.backward(params, forward_sweep, deltas, backward_derivatives, scratch);
+
+    double error_backward = 0.0;
+    auto bditer = backward_derivatives.begin();
+    for(auto& ourdi : our_derivatives) {
+      error_backward += (ourdi - *bditer) * (ourdi - *bditer);
+      bditer++;
+    }
+    error_backward = sqrt(error_backward);
+    if(error_backward > 1e-10)
+      ++nbfails_backward;
+
     /*
     std::cout << "numerical " << std::endl;
     for(auto & di : derivatives)
@@ -166,4 +189,5 @@ int main(int argc, char* argv[]) {
   }
 
   std::cout << nbfails << " / " << nbtrials << " with an error higher than 1e-7" << std::endl;
+  std::cout << nbfails_backward << " / " << nbtrials << " with a difference higher than 1e-10 between backpropagation and the per-parameter derivatives" << std::endl;
 }
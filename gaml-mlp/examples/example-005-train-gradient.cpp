@@ -83,13 +83,19 @@ int main(int argc, char * argv[])
 
   // Set up the parameters for learning the MLP with a gradient descent
   gaml::mlp::learner::gradient::parameter gradient_params;
-  gradient_params.alpha = 1e-2;
+  gradient_params.alpha = 5e-2;
   gradient_params.dalpha = 1e-3;
 
   gradient_params.verbose = true;
   // The stopping criteria
   gradient_params.max_iter = 10000;
   gradient_params.min_dparams = 1e-7;
+  // The gradients are averaged over mini-batches of 8 samples, which
+  // are shared among 4 threads. With a batch size of 1, the learning is
+  // online. As the parameters are updated once per batch, the learning
+  // rate is higher than for online learning.
+  gradient_params.batch_size = 8;
+  gradient_params.nb_threads = 4;
 
   // Create the learner
   auto learning_algorithm = gaml::mlp::learner::gradient::algorithm(mlp, gradient_params, gaml::mlp::loss::Quadratic(), fillOutput, gen);
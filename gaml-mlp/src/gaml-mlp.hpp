@@ -9,6 +9,9 @@
 #include <easykf.h>
 #include <exception>
 #include <random>
+#include <thread>
+#include <barrier>
+#include <atomic>
 
 /**
  * @example example-001-basics.cpp
@@ -54,15 +57,180 @@ namespace gaml {
     typedef std::vector<double> parameters_type;
 
     
+    //! The transfer functions the layers know how to compute with dedicated kernels
+    enum class TransferKind {custom, identity, sigmoid, tanh, lecuntanh, softmax};
+
+    /*!
+      Dense kernels working on contiguous memory. They are used by the
+      layers for the transfer functions they know (see TransferKind),
+      so that no indirect call is made on a per-element basis. The
+      loops are written so that the compiler can vectorize them.
+    */
+    namespace kernel {
+
+      /*!
+	Computes y = W x + b, where W is a row-major nb_rows x (nb_cols+1)
+	matrix whose last column holds the biases. This is the layout of
+	the parameters of a layer.
+      */
+      inline void dense(const double* w, const double* x, double* y,
+			unsigned int nb_rows, unsigned int nb_cols) {
+	unsigned int stride = nb_cols + 1;
+	unsigned int nb_blocks = nb_cols / 4;
+	for(unsigned int k = 0; k < nb_rows; ++k, w += stride) {
+	  // Four independent partial sums, so that the products over
+	  // the row can be processed as a vector
+	  double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	  const double* wb = w;
+	  const double* xb = x;
+	  for(unsigned int b = 0; b < nb_blocks; ++b, wb += 4, xb += 4) {
+	    s0 += wb[0] * xb[0];
+	    s1 += wb[1] * xb[1];
+	    s2 += wb[2] * xb[2];
+	    s3 += wb[3] * xb[3];
+	  }
+	  double res = (s0 + s1) + (s2 + s3);
+	  for(unsigned int j = 4 * nb_blocks; j < nb_cols; ++j)
+	    res += w[j] * x[j];
+	  y[k] = res + w[nb_cols];
+	}
+      }
+
+      /*!
+	Computes y_s = W x_s + b for nb samples at once, the sample s
+	being read from x + s*stride and written at y + s*stride. The
+	inputs are first gathered feature by feature in a per-thread
+	buffer, so that each weight is applied to all the samples in a
+	contiguous loop, and W is read once for the whole batch.
+      */
+      inline void dense_batch(const double* w, const double* x, double* y,
+			      unsigned int nb_rows, unsigned int nb_cols,
+			      unsigned int nb, std::size_t stride) {
+	static thread_local std::vector<double> xt;
+	static thread_local std::vector<double> acc;
+	if(xt.size() < nb_cols * nb)
+	  xt.resize(nb_cols * nb);
+	if(acc.size() < nb)
+	  acc.resize(nb);
+	double* t = xt.data();
+	double* a = acc.data();
+
+	for(unsigned int s = 0; s < nb; ++s) {
+	  const double* xs = x + s * stride;
+	  for(unsigned int j = 0; j < nb_cols; ++j)
+	    t[j * nb + s] = xs[j];
+	}
+
+	for(unsigned int k = 0; k < nb_rows; ++k, w += nb_cols + 1) {
+	  for(unsigned int s = 0; s < nb; ++s)
+	    a[s] = w[nb_cols];
+	  const double* xj = t;
+	  for(unsigned int j = 0; j < nb_cols; ++j, xj += nb) {
+	    double wj = w[j];
+	    for(unsigned int s = 0; s < nb; ++s)
+	      a[s] += wj * xj[s];
+	  }
+	  for(unsigned int s = 0; s < nb; ++s)
+	    y[s * stride + k] = a[s];
+	}
+      }
+
+      inline void sigmoid(double* begin, double* end, double slope) {
+	for(double* it = begin; it != end; ++it)
+	  *it = 1.0 / (1.0 + std::exp(-slope * (*it)));
+      }
+
+      inline void tanh(double* begin, double* end) {
+	for(double* it = begin; it != end; ++it)
+	  *it = std::tanh(*it);
+      }
+
+      inline void lecuntanh(double* begin, double* end) {
+	for(double* it = begin; it != end; ++it)
+	  *it = 1.7159 * std::tanh(2.0 * (*it) / 3.0);
+      }
+
+      //! The maximal value is removed before exponentiation, for numerical stability
+      inline void softmax(double* begin, double* end) {
+	if(begin == end)
+	  return;
+	double max = *std::max_element(begin, end);
+	double sum_exp = 0;
+	for(double* it = begin; it != end; ++it) {
+	  *it = std::exp(*it - max);
+	  sum_exp += *it;
+	}
+	double inv_sum_exp = 1.0 / sum_exp;
+	for(double* it = begin; it != end; ++it)
+	  *it *= inv_sum_exp;
+      }
+
+      //! Applies a transfer function of a known kind to the net inputs in [begin, end)
+      inline void transfer(TransferKind kind, double slope, double* begin, double* end) {
+	switch(kind) {
+	case TransferKind::sigmoid   : sigmoid(begin, end, slope); break;
+	case TransferKind::tanh      : tanh(begin, end);           break;
+	case TransferKind::lecuntanh : lecuntanh(begin, end);      break;
+	case TransferKind::softmax   : softmax(begin, end);        break;
+	default                      :                             break;
+	}
+      }
+
+      /*!
+	Computes the derivatives dL/dy_k of the loss along the net
+	inputs y_k, given the derivatives dL/dz_k along the activities
+	z_k = f(y) and the activities themselves. This requires the
+	transfer function to be of a known kind.
+      */
+      inline void transfer_backward(TransferKind kind, double slope,
+				    const double* z_begin, const double* z_end,
+				    const double* dz, double* dy) {
+	switch(kind) {
+	case TransferKind::identity :
+	  std::copy(dz, dz + (z_end - z_begin), dy);
+	  break;
+	case TransferKind::sigmoid :
+	  for(const double* z = z_begin; z != z_end; ++z)
+	    *(dy++) = *(dz++) * slope * (*z) * (1.0 - *z);
+	  break;
+	case TransferKind::tanh :
+	  for(const double* z = z_begin; z != z_end; ++z)
+	    *(dy++) = *(dz++) * (1.0 - (*z) * (*z));
+	  break;
+	case TransferKind::lecuntanh :
+	  for(const double* z = z_begin; z != z_end; ++z) {
+	    double thx = *z / 1.7159;
+	    *(dy++) = *(dz++) * 1.7159 * 2.0 / 3.0 * (1.0 - thx * thx);
+	  }
+	  break;
+	case TransferKind::softmax : {
+	  // dL/dy_k = z_k (dL/dz_k - \sum_j dL/dz_j z_j)
+	  double dot = 0;
+	  const double* dzj = dz;
+	  for(const double* z = z_begin; z != z_end; ++z)
+	    dot += *(dzj++) * (*z);
+	  for(const double* z = z_begin; z != z_end; ++z)
+	    *(dy++) = (*z) * (*(dz++) - dot);
+	  break;
+	}
+	default :
+	  break;
+	}
+      }
+    }
+
     //! Transfer function type (at the layer level, this allows to define transfer functions combinining several values within the same layer)
     /*!
-      Function contains the function and its derivative (used for updating the weights with backprop)
+      Function contains the function and its derivative (used for updating the weights with backprop).
+      The kind tells the layers whether they can use a dedicated kernel (see gaml::mlp::kernel) rather than _f.
     */
     struct LayerTransferFunction
     {
       typedef std::function<void (values_type::iterator, values_type::iterator)> function_type;
       function_type _f;
-      LayerTransferFunction(const function_type& f): _f(f) {}
+      TransferKind _kind;
+      double _slope;
+      LayerTransferFunction(const function_type& f, TransferKind kind = TransferKind::custom, double slope = 1.0): _f(f), _kind(kind), _slope(slope) {}
     };
 
 
@@ -70,15 +238,17 @@ namespace gaml {
     {
       typedef std::function<void (values_type::iterator, values_type::iterator, unsigned int )> function_type;
       function_type _f;
-      LayerDTransferFunction(const function_type& f): _f(f) {}
+      TransferKind _kind;
+      double _slope;
+      LayerDTransferFunction(const function_type& f, TransferKind kind = TransferKind::custom, double slope = 1.0): _f(f), _kind(kind), _slope(slope) {}
     };
     
 
-    LayerTransferFunction layer_transfer_function(const LayerTransferFunction::function_type& f) {
-      return LayerTransferFunction(f);
+    LayerTransferFunction layer_transfer_function(const LayerTransferFunction::function_type& f, TransferKind kind = TransferKind::custom, double slope = 1.0) {
+      return LayerTransferFunction(f, kind, slope);
     }
-    LayerDTransferFunction layer_dtransfer_function(const LayerDTransferFunction::function_type& f) {
-      return LayerDTransferFunction(f);
+    LayerDTransferFunction layer_dtransfer_function(const LayerDTransferFunction::function_type& f, TransferKind kind = TransferKind::custom, double slope = 1.0) {
+      return LayerDTransferFunction(f, kind, slope);
     }
 
     template<typename FUNCTYPE, typename ITERATOR>
@@ -94,20 +264,20 @@ namespace gaml {
     }
 
     LayerTransferFunction mlp_identity() {
-      return layer_transfer_function([] (values_type::iterator begin, values_type::iterator end) -> void { return;});
+      return layer_transfer_function([] (values_type::iterator begin, values_type::iterator end) -> void { return;}, TransferKind::identity);
     }
     LayerDTransferFunction mlp_didentity() {
       return layer_dtransfer_function([] (values_type::iterator begin, values_type::iterator end, unsigned int dim) -> void {
 	  auto f = [dim] (double x, unsigned int d) -> double { return d == dim ? 1.0 : 0.0;};
 	  apply_function_dim(f, begin, end);
-	});
+	}, TransferKind::identity);
     }
 
     LayerTransferFunction mlp_sigmoid(double slope = 1.0) {
       return layer_transfer_function([slope] (values_type::iterator begin, values_type::iterator end) -> void {
 	  auto f = [slope] (double x) -> double { return 1.0/(1.0 + exp(-slope * x));};
 	  apply_function(f, begin, end);
-	});
+	}, TransferKind::sigmoid, slope);
     }
     LayerDTransferFunction mlp_dsigmoid(double slope=1.0) {
       return layer_dtransfer_function([slope] (values_type::iterator begin, values_type::iterator end, unsigned int dim) -> void {
@@ -118,14 +288,14 @@ namespace gaml {
 	    return slope * ex/((1.0 + ex)*(1.0+ex));
 	  };
 	  apply_function_dim(f, begin, end);
-	});
+	}, TransferKind::sigmoid, slope);
     }
 
     LayerTransferFunction mlp_tanh() {
       return layer_transfer_function([] (values_type::iterator begin, values_type::iterator end) -> void {
 	  auto f = [] (double x) -> double { return tanh(x);};
 	  apply_function(f, begin, end);	  
-	});
+	}, TransferKind::tanh);
     }
     LayerDTransferFunction mlp_dtanh() {
       return layer_dtransfer_function([] (values_type::iterator begin, values_type::iterator end, unsigned int dim) -> void {
@@ -136,7 +306,7 @@ namespace gaml {
 	    return 1.0 - thx*thx;
 	  };
 	  apply_function_dim(f, begin, end);	  
-	});
+	}, TransferKind::tanh);
     }
 
 
@@ -144,7 +314,7 @@ namespace gaml {
       return layer_transfer_function([] (values_type::iterator begin, values_type::iterator end) -> void {
 	  auto f = [] (double x) -> double { return 1.7159 * tanh(2.0 * x / 3.0);};
 	  apply_function(f, begin, end);	  
-	});
+	}, TransferKind::lecuntanh);
     }
     LayerDTransferFunction mlp_lecundtanh() {
       return layer_dtransfer_function([] (values_type::iterator begin, values_type::iterator end, unsigned int dim) -> void {
@@ -155,7 +325,7 @@ namespace gaml {
 	    return 1.7159 * 2.0 / 3.0 * (1.0 - thx*thx);
 	  };
 	  apply_function_dim(f, begin, end);	  
-	});
+	}, TransferKind::lecuntanh);
     }
 
     LayerTransferFunction mlp_softmax() {
@@ -172,7 +342,7 @@ namespace gaml {
 	  while(it != end)
 	    *(it++) /= sum_exp;
 	  
-	});
+	}, TransferKind::softmax);
     }
 
     LayerDTransferFunction mlp_dsoftmax() {
@@ -207,7 +377,7 @@ namespace gaml {
 	      *it = -*it * expdim / sum_exp2;
 	    ++it; ++d;
 	  }
-	});
+	}, TransferKind::softmax);
     }  
 
 
@@ -268,6 +438,15 @@ namespace gaml {
 	    res += -2.0 * (*ittarget - *itoutput) * (*itdoutput);
 	  return res;
 	}
+
+	// The derivative of the quadratic cost along each output of the perceptron,
+	// written from delta, for the backward sweep
+	template<typename ITERATOR>
+	void output_deriv(const values_type& target, const values_type& forward_sweep, ITERATOR delta) const {
+	  auto itoutput = forward_sweep.end() - target.size();
+	  for(auto& t: target)
+	    *(delta++) = -2.0 * (t - *(itoutput++));
+	}
       };
 
       class CrossEntropy : public Loss{
@@ -299,6 +478,17 @@ namespace gaml {
 	    res += (*ittarget) * (*itdoutput) / (*itoutput+DBL_EPSILON)- (1.0 - *ittarget) * (*itdoutput) / (1.0 - *itoutput+DBL_EPSILON);
 	  return -res;
 	}
+
+	// The derivative of the cross entropy cost along each output of the perceptron,
+	// written from delta, for the backward sweep
+	template<typename ITERATOR>
+	void output_deriv(const values_type& target, const values_type& forward_sweep, ITERATOR delta) const {
+	  auto itoutput = forward_sweep.end() - target.size();
+	  for(auto& t: target) {
+	    *(delta++) = -(t / (*itoutput + DBL_EPSILON) - (1.0 - t) / (1.0 - *itoutput + DBL_EPSILON));
+	    ++itoutput;
+	  }
+	}
 	
 
       };
@@ -442,6 +632,18 @@ namespace gaml {
 	_fill_input(begin(output), input);
       }
 
+      /*! Fills in the input values of nb samples, the values of the sample s starting at output.begin() + s*stride
+	\returns The iterator on the input following the last one used
+	\sa gaml::mlp::Layer::batch
+      */
+      template<typename InputIterator>
+      InputIterator batch(InputIterator input, unsigned int nb, const parameters_type& params, values_type& output, std::size_t stride) const
+      {
+	for(unsigned int s = 0; s < nb; ++s, ++input)
+	  _fill_input(output.begin() + s * stride, *input);
+	return input;
+      }
+
       void deriv(const input_type& input, 
 		 const parameters_type& params, 
 		 const values_type& forward_sweep, // This contains the output of all the layers from the forward sweep
@@ -452,6 +654,17 @@ namespace gaml {
 	  *it = 0;
       }
 
+      /*! End of the backward sweep, an input layer has no parameter to feed
+	\sa gaml::mlp::Layer::backward
+      */
+      void backward(const parameters_type& params,
+		    const values_type& forward_sweep,
+		    values_type& deltas,
+		    parameters_type& gradient,
+		    values_type& scratch) const {
+	return;
+      }
+
       friend std::ostream& operator<<(std::ostream& os, const InputLayer& l)
       {
 	os << l._size << " - input ";
@@ -638,30 +851,52 @@ namespace gaml {
 	// Let the previous layer do its computations
 	_previous(input, params, output);
 
-	// We now do our job
-	auto wptr = params.begin() + _previous._params_end;
-	double res;
-	
-	auto iter_end = end(output);
-	for(auto iter= begin(output); iter != iter_end ; ++iter)
-	  {
-	    res = 0;
-	    // Compute the weighted sum of the inputs
-	    auto iter_previous_end = _previous.end(output);
-	    for(auto iter_previous = _previous.begin(output); iter_previous != iter_previous_end; ++iter_previous)
-	      res += (*(wptr++)) * (*iter_previous);
-	    // Add the bias
-	    res += (*(wptr++)); 
-	    // Save the result of the weighted sum
-	    *iter = res;
-	  }
+	// We now do our job : the weighted sums of the previous
+	// activities (the weights of a unit, followed by its bias, are
+	// contiguous in params, i.e. they form a row-major matrix)
+	double* y = output.data() + _previous._values_end;
+	kernel::dense(params.data() + _previous._params_end,
+		      output.data() + (_previous._values_end - _previous._size),
+		      y, _size, _previous._size);
+
 	// Apply the transfer function
-	_tf._f(begin(output), end(output));
+	if(_tf._kind == TransferKind::custom)
+	  _tf._f(begin(output), end(output));
+	else
+	  kernel::transfer(_tf._kind, _tf._slope, y, y + _size);
+      }
+
+      /*! Computes the activities of the layer for nb samples, the values of the sample s starting at output.begin() + s*stride
+	\returns The iterator on the input following the last one used
+	This is the batch version of operator(), the weights are read once for all the samples.
+      */
+      template<typename InputIterator>
+      InputIterator batch(InputIterator input, unsigned int nb, const parameters_type& params, values_type& output, std::size_t stride) const {
+	InputIterator next = _previous.batch(input, nb, params, output, stride);
+
+	kernel::dense_batch(params.data() + _previous._params_end,
+			    output.data() + (_previous._values_end - _previous._size),
+			    output.data() + _previous._values_end,
+			    _size, _previous._size, nb, stride);
+
+	for(unsigned int s = 0; s < nb; ++s) {
+	  auto y = output.begin() + s * stride + _previous._values_end;
+	  if(_tf._kind == TransferKind::custom)
+	    _tf._f(y, y + _size);
+	  else
+	    kernel::transfer(_tf._kind, _tf._slope, &(*y), &(*y) + _size);
+	}
+	return next;
       }
 
       //! This is a temporary function, that I should remove, used only for the computation of the derivative
       // as I need the sum_i w_i y_i + b   without the application of the transfer function
       double compute_output(const input_type& input, const parameters_type& params, unsigned int index, const values_type& forward_sweep) const {
+	return net_input(params, index, forward_sweep);
+      }
+
+      //! The net input sum_i w_i y_i + b of the unit index, from the values of the previous layer in forward_sweep
+      double net_input(const parameters_type& params, unsigned int index, const values_type& forward_sweep) const {
 	double res = 0;
 	auto iter_previous_end = _previous.end(forward_sweep);
 	auto wptr = params.begin() + _previous._params_end + index * (_previous.lsize() + 1);
@@ -736,9 +971,8 @@ namespace gaml {
 	    auto it_derivative = begin(derivative);
 	    auto it_derivative_end = end(derivative);
 	    auto it_tf_derivative = tf_derivative.begin();
-	    auto it_input_derivatives = input_derivatives.begin();
-	    for(; it_derivative != it_derivative_end; ++it_derivative, ++it_tf_derivative, ++it_input_derivatives) 
-	      *it_derivative += (*it_tf_derivative) * (*it_input_derivatives);
+	    for(; it_derivative != it_derivative_end; ++it_derivative, ++it_tf_derivative) 
+	      *it_derivative += (*it_tf_derivative) * input_derivatives[k];
 	  }
 	}
 	else {
@@ -792,7 +1026,88 @@ namespace gaml {
 	  }
 	}
       }
-	
+
+      /*! Backward sweep (backpropagation) through this layer
+	On entry, the part of deltas owned by this layer contains the
+	derivatives dL/dz_j of the loss with respect to the activities z_j of this layer.
+	The method accumulates dL/dtheta in the part of gradient owned by this layer,
+	writes dL/dz into the part of deltas owned by the previous layer
+	and propagates the call backward. Together with a forward sweep, this
+	brings the whole gradient, whereas deriv needs one call per parameter.
+	\param forward_sweep The values of all the units, from the forward sweep
+	\param deltas A container of the same size as forward_sweep
+	\param gradient A container of the same size as params
+	\param scratch A workspace of 3 times the size of forward_sweep at least, so that no allocation is done
+      */
+      void backward(const parameters_type& params,
+		    const values_type& forward_sweep,
+		    values_type& deltas,
+		    parameters_type& gradient,
+		    values_type& scratch) const {
+	// dL/dy_k = \sum_j dL/dz_j dz_j/dy_k
+	// The first _size values of scratch receive them.
+	auto input_deltas_begin = scratch.begin();
+	auto input_deltas_end = input_deltas_begin + _size;
+	if(_dtf._kind != TransferKind::custom && _dtf._kind == _tf._kind) {
+	  // The derivative is known from the activities z of this layer
+	  const double* z = forward_sweep.data() + _previous._values_end;
+	  kernel::transfer_backward(_dtf._kind, _dtf._slope, z, z + _size,
+				    deltas.data() + _previous._values_end, scratch.data());
+	}
+	else {
+	  // We first compute the net inputs y_k = sum_i w_ki z_i + b_k
+	  auto inputs_begin = input_deltas_end;
+	  auto inputs_end = inputs_begin + _size;
+	  kernel::dense(params.data() + _previous._params_end,
+			forward_sweep.data() + (_previous._values_end - _previous._size),
+			scratch.data() + _size, _size, _previous._size);
+
+	  // The k-th column of the jacobian of the transfer function
+	  // is given by _dtf for dimension k
+	  auto tf_derivative_begin = inputs_end;
+	  auto tf_derivative_end = tf_derivative_begin + _size;
+	  auto delta_begin = begin(deltas);
+	  for(unsigned int k = 0 ; k < _size; ++k) {
+	    std::copy(inputs_begin, inputs_end, tf_derivative_begin);
+	    _dtf._f(tf_derivative_begin, tf_derivative_end, k);
+	    double res = 0;
+	    auto it_delta = delta_begin;
+	    for(auto it = tf_derivative_begin; it != tf_derivative_end; ++it)
+	      res += (*it) * (*(it_delta++));
+	    *(input_deltas_begin + k) = res;
+	  }
+	}
+
+	// dL/dw_ki = dL/dy_k z_i and dL/db_k = dL/dy_k
+	auto giter = gradient.begin() + _previous._params_end;
+	auto iter_previous_begin = _previous.begin(forward_sweep);
+	auto iter_previous_end = _previous.end(forward_sweep);
+	for(auto it_dk = input_deltas_begin; it_dk != input_deltas_end; ++it_dk) {
+	  double dk = *it_dk;
+	  for(auto iter_previous = iter_previous_begin; iter_previous != iter_previous_end; ++iter_previous)
+	    *(giter++) += dk * (*iter_previous);
+	  *(giter++) += dk;
+	}
+
+	// If some parameters lie below, we go on with dL/dz_i = \sum_k dL/dy_k w_ki
+	if(_previous._params_end == 0)
+	  return;
+
+	auto previous_delta_begin = _previous.begin(deltas);
+	auto previous_delta_end = _previous.end(deltas);
+	std::fill(previous_delta_begin, previous_delta_end, 0.0);
+	auto wptr = params.begin() + _previous._params_end;
+	for(auto it_dk = input_deltas_begin; it_dk != input_deltas_end; ++it_dk) {
+	  double dk = *it_dk;
+	  for(auto it_delta = previous_delta_begin; it_delta != previous_delta_end; ++it_delta)
+	    *it_delta += dk * (*(wptr++));
+	  // Skip the bias
+	  ++wptr;
+	}
+	// The previous layer reuses scratch, input_deltas is not needed anymore
+	_previous.backward(params, forward_sweep, deltas, gradient, scratch);
+      }
+
 
       friend std::ostream& operator<<(std::ostream& os, const Layer& l)
       {
@@ -956,9 +1271,46 @@ namespace gaml {
       }
 
       //! Evaluate the Perceptron on the input with the given parameters
+      /*!
+	The values of the units are stored inside the perceptron (see begin() and end()),
+	so this is not reentrant. Use the overload with a workspace for concurrent evaluations.
+      */
       output_type operator()(const typename layer_type::input_type& input, const parameters_type& params) const {
-	_last_layer(input, params, _values);
-	return (*_output_of)(_last_layer.begin(_values));
+	return (*this)(input, params, _values);
+      }
+
+      //! Evaluate the Perceptron on the input with the given parameters, using values as a workspace
+      /*!
+	\param values A workspace of size() elements at least. It receives the values of all the units.
+	This does not modify the perceptron, so several threads can evaluate it at once with their own workspace.
+      */
+      output_type operator()(const typename layer_type::input_type& input, const parameters_type& params, values_type& values) const {
+	return (*_output_of)(forward(input, params, values));
+      }
+
+      //! Computes the forward sweep in values, and returns an iterator on the outputs
+      /*!
+	\param values A workspace of size() elements at least. It receives the values of all the units.
+	The output_size() values of the output layer are read from the returned iterator, without any conversion into an output_type.
+      */
+      values_type::const_iterator forward(const typename layer_type::input_type& input, const parameters_type& params, values_type& values) const {
+	_last_layer(input, params, values);
+	return _last_layer.begin(const_cast<const values_type&>(values));
+      }
+
+      //! Computes the forward sweeps of nb inputs at once
+      /*!
+	\param values A workspace of nb*size() elements at least. The values of the units for the s-th input are stored from values.begin() + s*size().
+	\returns The iterator on the input following the last one used
+      */
+      template<typename InputIterator>
+      InputIterator forward_batch(InputIterator input, unsigned int nb, const parameters_type& params, values_type& values) const {
+	return _last_layer.batch(input, nb, params, values, size());
+      }
+
+      //! Converts the values of the output layer, e.g. returned by forward, into an output_type
+      output_type output_of(values_type::const_iterator outputs) const {
+	return (*_output_of)(outputs);
       }
 
       //!Compute the derivative of all the activities along the dim dimension
@@ -970,7 +1322,22 @@ namespace gaml {
 	values_type derivative(this->size());
 	_last_layer.deriv(input, params, forward_sweep, parameter_dim, derivative);
 	return derivative;
-	
+
+      }
+
+      //! Compute the whole gradient of the loss with a single backward sweep
+      /*!
+	\param forward_sweep The values of all the units, from the forward sweep
+	\param deltas A container of size size(), whose last output_size() elements contain the derivatives of the loss along the outputs. It is used as a workspace.
+	\param gradient A container of size psize() where the derivatives along each parameter are accumulated.
+	\param scratch A workspace of 3*size() elements at least. It is allocated once by the caller, so that the sweep does no allocation.
+      */
+      void backward(const parameters_type& params,
+		    const values_type& forward_sweep,
+		    values_type& deltas,
+		    parameters_type& gradient,
+		    values_type& scratch) const {
+	_last_layer.backward(params, forward_sweep, deltas, gradient, scratch);
       }
 
       friend std::ostream& operator<<(std::ostream& os, const Perceptron& p)
@@ -1044,8 +1411,55 @@ namespace gaml {
 	return *this;
       }
   
+      //! The type of the workspace for the evaluation of the perceptron
+      typedef values_type workspace_type;
+
+      //! Returns a workspace of the right size for operator()(const input_type&, workspace_type&)
+      workspace_type workspace() const {
+	return workspace_type(_mlp.size());
+      }
+
+      //! The prediction, using ws as a workspace. No allocation is done if ws has the right size.
+      output_type operator()(const input_type& x, workspace_type& ws) const {
+	return _mlp(x, _params, ws);
+      }
+
+      /*!
+	The prediction. Each thread uses its own workspace, allocated on
+	its first call, so a single predictor can be shared among threads.
+      */
       output_type operator()(const input_type& x) const {
-	return _mlp(x, _params);
+	static thread_local workspace_type ws;
+	if(ws.size() < _mlp.size())
+	  ws.resize(_mlp.size());
+	return (*this)(x, ws);
+      }
+
+      //! The number of inputs which are propagated together by predict_batch
+      static constexpr unsigned int batch_block = 32;
+
+      /*!
+	The predictions of the inputs in [begin, end). They are
+	propagated by blocks of batch_block inputs, so that the weights
+	are read once per block rather than once per input. As
+	operator(), this can be called by several threads at once.
+      */
+      template<typename InputIterator, typename OutputIterator>
+      void predict_batch(const InputIterator& begin, const InputIterator& end, OutputIterator out) const {
+	static thread_local workspace_type ws;
+	std::size_t size = _mlp.size();
+	if(ws.size() < batch_block * size)
+	  ws.resize(batch_block * size);
+	std::size_t output_offset = size - _mlp.output_size();
+
+	InputIterator it = begin;
+	while(it != end) {
+	  unsigned int nb = 0;
+	  for(InputIterator block_end = it; block_end != end && nb < batch_block; ++block_end, ++nb);
+	  it = _mlp.forward_batch(it, nb, _params, ws);
+	  for(unsigned int s = 0; s < nb; ++s)
+	    *(out++) = _mlp.output_of(ws.begin() + s * size + output_offset);
+	}
       }
 
       friend std::ostream& operator<<(std::ostream& os, const Predictor& p)
@@ -1078,8 +1492,57 @@ namespace gaml {
 
 	  int max_iter; //!< Number of times we see the training base before stopping
 	  double min_dparams; //!< Minimum difference in the parameter update before stopping
+
+	  unsigned int batch_size = 1; //!< Number of samples whose gradients are averaged for each update (1 is online learning)
+	  unsigned int nb_threads = 1; //!< Number of threads sharing the computation of the gradients of a batch
 	};
 
+	//! The per-thread resources for computing gradients
+	/*!
+	  Each worker owns its forward sweep and backward sweep workspaces and its gradient buffer.
+	*/
+	template<typename mlp_type>
+	struct Worker {
+	  const mlp_type& mlp;
+	  values_type forward_sweep;
+	  values_type deltas;
+	  values_type scratch;
+	  values_type output_vector;
+	  parameters_type gradient;
+
+	  Worker(const mlp_type& mlp) :
+	    mlp(mlp),
+	    forward_sweep(mlp.size()),
+	    deltas(mlp.size()),
+	    scratch(3 * mlp.size()),
+	    output_vector(mlp.output_size()),
+	    gradient(mlp.psize()) {}
+
+	  //! Sets gradient to the sum of the gradients of the loss for the samples in [begin, end)
+	  template<typename DataIterator, typename InputOf, typename OutputOf, typename loss_function_type, typename fill_output_function_type>
+	  void operator()(const DataIterator& begin, const DataIterator& end,
+			  const InputOf& input_of, const OutputOf& output_of,
+			  const parameters_type& params,
+			  const loss_function_type& loss,
+			  const fill_output_function_type& fill_output) {
+	    std::fill(gradient.begin(), gradient.end(), 0.0);
+	    for(auto iter = begin; iter != end; ++iter) {
+	      auto x = input_of(*iter);
+	      auto y = output_of(*iter);
+
+	      // We compute the forward sweep of the MLP
+	      mlp.forward(x, params, forward_sweep);
+
+	      // We must convert the output y into its vector representation
+	      fill_output(output_vector.begin(), y);
+
+	      // We accumulate the gradient of the cost function
+	      // along all the parameters with a single backward sweep
+	      loss.output_deriv(output_vector, forward_sweep, deltas.end() - output_vector.size());
+	      mlp.backward(params, forward_sweep, deltas, gradient, scratch);
+	    }
+	  }
+	};
 
 	template<typename mlp_type,
 		 typename loss_function_type,
@@ -1134,18 +1597,13 @@ namespace gaml {
 	    // And store a copy of its last values to compute its variations
 	    auto previous_params = params;
 
-	    // A structure for holding the gradient of the cost function
-	    parameters_type gradient(params.size());
-	    values_type forward_sweep(_mlp.size());
-	    values_type output_vector(_mlp.output_size());
-
-	    // We build functions required by the derivative of the loss
-	    // These two functions must return values_type 
-	    // and not an element of the type mlp_type::output_type
-	    auto f = [this, &params] (const typename mlp_type::input_type& x) -> values_type { auto output = this->_mlp(x, params); values_type voutput(this->_mlp.output_size()); this->_fillOutput(voutput.begin(), output); return voutput;};
-	    auto df = [this, &forward_sweep, &params] (const typename mlp_type::input_type& x,
-						       int parameter_dim) -> values_type { 
-	      return this->_mlp.deriv(x, params, forward_sweep, parameter_dim);};
+	    // Each thread accumulates the gradients of its share of a
+	    // batch in its own worker. The gradient of the batch is
+	    // then reduced in the first one.
+	    unsigned int batch_size = std::max(1u, _gradient_parameters.batch_size);
+	    unsigned int nb_threads = std::max(1u, std::min(_gradient_parameters.nb_threads, batch_size));
+	    std::vector<Worker<mlp_type>> workers(nb_threads, Worker<mlp_type>(_mlp));
+	    auto& gradient = workers[0].gradient;
 
 	    int epoch;
 	    double diff_params;
@@ -1158,36 +1616,77 @@ namespace gaml {
 		// as learning is done online
 		//std::random_shuffle(begin, end);
 		auto shuffled = gaml::shuffle(begin, end, _rd);
-
-
-		for(auto iter = shuffled.begin(); iter != shuffled.end() ; ++iter)
-		  {
-		    // Initialize the gradient
-		    std::fill(gradient.begin(), gradient.end(), 0.0);
-
-		    auto x = input_of(*iter);
-		    auto y = output_of(*iter);
-
-		    // We compute the forward sweep of the MLP
-		    // for optimization reasons in the computation of the derivative of the loss
-		    _mlp(x, params);
-		    std::copy(_mlp.begin(), _mlp.end(), forward_sweep.begin());
-
-		    // We must convert the output y into its vector representation
-		    _fillOutput(output_vector.begin(), y);
-
-		    // We compute the gradient of the cost function
-		    // along each of the parameters
-		    auto giter = gradient.begin();
-		    // We can now compute the gradient of the loss function
-		    for(unsigned int i = 0 ; i < gradient.size() ; ++i)
-		      *giter++ = _loss.deriv(x, output_vector, forward_sweep, f, df, i);
-
-		    // We can now update the parameters
-		    giter = gradient.begin();
-		    for(auto& piter : params)
-		      piter = piter - lrate * (*giter++);
+		auto shuffled_begin = shuffled.begin();
+		unsigned int nb_samples = shuffled.end() - shuffled_begin;
+
+		// Reduces the gradients of the workers and updates the
+		// parameters for the batch starting at batch_begin. The
+		// reduction is done in a fixed order, so that the result
+		// does not depend on thread scheduling.
+		auto update = [&params, &workers, &gradient, lrate, batch_size, nb_samples] (unsigned int batch_begin) {
+		  for(unsigned int w = 1; w < workers.size(); ++w) {
+		    auto giter = workers[w].gradient.begin();
+		    for(auto& g : gradient)
+		      g += *(giter++);
+		  }
+		  double step = lrate / (std::min(batch_begin + batch_size, nb_samples) - batch_begin);
+		  auto giter = gradient.begin();
+		  for(auto& piter : params)
+		    piter = piter - step * (*giter++);
+		};
+
+		// The part of the batch starting at batch_begin handled by worker w
+		auto work = [&, batch_size, nb_samples, nb_threads] (unsigned int w, unsigned int batch_begin) {
+		  unsigned int size = std::min(batch_begin + batch_size, nb_samples) - batch_begin;
+		  workers[w](shuffled_begin + (batch_begin + (w * size) / nb_threads),
+			     shuffled_begin + (batch_begin + ((w + 1) * size) / nb_threads),
+			     input_of, output_of, params, _loss, _fillOutput);
+		};
+
+		if(nb_threads == 1)
+		  for(unsigned int batch_begin = 0; batch_begin < nb_samples; batch_begin += batch_size) {
+		    work(0, batch_begin);
+		    update(batch_begin);
 		  }
+		else {
+		  // The threads live for the whole epoch. After each
+		  // batch, they wait for each other and the last one to
+		  // arrive performs the update. If a worker throws, the
+		  // exception is kept and the worker still arrives at the
+		  // barrier, so that the others do not wait for it. They
+		  // all stop after that batch, which is not applied, and
+		  // the exception is rethrown.
+		  unsigned int current_batch = 0;
+		  std::vector<std::exception_ptr> errors(nb_threads);
+		  std::atomic<bool> failed(false);
+		  auto on_batch_completion = [&update, &current_batch, &failed, batch_size] () noexcept {
+		    if(!failed)
+		      update(current_batch);
+		    current_batch += batch_size;
+		  };
+		  std::barrier sync(nb_threads, on_batch_completion);
+		  std::vector<std::thread> threads;
+		  for(unsigned int w = 0; w < nb_threads; ++w)
+		    threads.push_back(std::thread([&work, &sync, &errors, &failed, w, batch_size, nb_samples] () {
+			  for(unsigned int batch_begin = 0; batch_begin < nb_samples; batch_begin += batch_size) {
+			    try {
+			      work(w, batch_begin);
+			    }
+			    catch(...) {
+			      errors[w] = std::current_exception();
+			      failed = true;
+			    }
+			    sync.arrive_and_wait();
+			    if(failed)
+			      break;
+			  }
+			}));
+		  for(auto& t : threads)
+		    t.join();
+		  for(auto& error : errors)
+		    if(error)
+		      std::rethrow_exception(error);
+		}
 
 		// Let us compute the norm of the parameters update
 		auto iter = params.begin();
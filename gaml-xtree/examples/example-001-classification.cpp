@@ -127,6 +127,22 @@ int main(int argc, char* argv[]) {
   
   // The forest predictor outputs a label.
 
+  // The forest can be compiled into flat arrays and saved in a binary
+  // file. Loading maps the file in memory, nothing is parsed. The
+  // loaded forest predicts the same labels.
+  std::ofstream bfile("forest.bin", std::ios::binary);
+  gaml::xtree::binary::write(bfile, gaml::xtree::flatten(forest));
+  bfile.close();
+  // The trees of the file output frequency maps.
+  typedef gaml::xtree::classification::Predictor<X,Y>::output_type Frequencies;
+  auto flat_forest = gaml::xtree::binary::load_forest<X,Frequencies>("forest.bin", gaml::functor::highest_cumulated_frequency<Y>());
+  unsigned int nb_differences = 0;
+  for(auto& xy : basis)
+    if(forest(xy.first) != flat_forest(xy.first))
+      ++nb_differences;
+  std::cout << "The forest loaded from \"forest.bin\" differs from the learnt one on "
+	    << nb_differences << " of the " << basis.size() << " samples." << std::endl;
+
 
   // This does the plotting
 
@@ -140,6 +156,8 @@ int main(int argc, char* argv[]) {
        [](const gaml::xtree::classification::Predictor<X,Y>::output_type& frequencies) -> Y {return gaml::most_frequent(frequencies);});
   plot("forest",forest,
        [](Y y) -> Y {return y;});
+  plot("flat-forest",flat_forest,
+       [](Y y) -> Y {return y;});
   
   return 0;
 }
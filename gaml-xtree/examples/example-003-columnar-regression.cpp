@@ -0,0 +1,149 @@
+#include <gaml.hpp>
+#include <gaml-xtree.hpp>
+
+#include <fstream>
+#include <vector>
+#include <array>
+#include <utility>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <algorithm>
+
+#define DIM             2
+#define XMIN            0
+#define XMAX           10
+#define PLOT_STEP      .1
+#define NOISE          .2
+
+typedef std::array<double,DIM> X;
+typedef double                 Y;
+typedef std::pair<X,Y>         Data;
+typedef std::vector<Data>      Basis;
+
+const X& input_of (const Data& d) {return d.first;}
+const Y  output_of(const Data& d) {return d.second;}
+
+Y oracle(const X& x) {
+  return std::sin(x[0])*std::sin(x[1]);
+}
+
+template<typename RANDOM_DEVICE>
+Data sample(RANDOM_DEVICE& rd) {
+  std::uniform_real_distribution<double> uniform(  XMIN,  XMAX);
+  std::uniform_real_distribution<double> noise  (-NOISE, NOISE);
+  X x = {{uniform(rd), uniform(rd)}};
+  return {x, oracle(x) + noise(rd)};
+}
+
+// This counts the grid points where two predictors disagree.
+template<typename PRED1, typename PRED2>
+unsigned int nb_differences(const PRED1& p1, const PRED2& p2) {
+  unsigned int nb = 0;
+  X input;
+  double& x0 = input[0];
+  double& x1 = input[1];
+  for(x0 = XMIN; x0 <= XMAX; x0 += PLOT_STEP)
+    for(x1 = XMIN; x1 <= XMAX; x1 += PLOT_STEP)
+      if(p1(input) != p2(input))
+	++nb;
+  return nb;
+}
+	      
+
+int main(int argc, char* argv[]) {
+
+  if(argc != 4) {
+    std::cout << "Usage : " << argv[0]
+	      << " <forest-size> <nb-samples> <max-leaf-size>" << std::endl
+	      << "  e.g : " << argv[0] << " 100 1000 50" << std::endl;
+      return 0;
+  }
+  
+  // random seed initialization
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  
+  unsigned int forest_size   = (unsigned int)(atoi(argv[1]));
+  unsigned int nb_samples    = (unsigned int)(atoi(argv[2]));
+  unsigned int max_leaf_size = (unsigned int)(atoi(argv[3]));
+  unsigned int nb_threads    = std::max(1u, std::thread::hardware_concurrency());
+  std::uint64_t seed         = gen();
+
+
+  
+  Basis basis(nb_samples);
+  for(auto& xy : basis) xy = sample(gen);
+
+  // The columnar learner builds the same trees as
+  // gaml::xtree::regression::learner, from a column-major copy of the
+  // inputs, which is faster on large bases.
+  auto learner = gaml::xtree::regression::columnar_learner<X, Y, gaml::score::RelativeVarianceReduction>(max_leaf_size, DIM, gen);
+
+  // The trees of the forest are learnt in parallel, each thread using
+  // its own copy of the learner. The copies are reseeded from the last
+  // argument, so the forest only depends on that seed, not on the
+  // number of threads.
+  auto forest_learner = gaml::bag::learner(learner,
+					   gaml::functor::average(),
+					   gaml::bag::functor::identity(),
+					   forest_size,true,
+					   nb_threads, seed);
+  std::cout << "Learning a forest with " << nb_threads << " threads... " << std::flush;
+  auto forest = forest_learner(basis.begin(), basis.end(), input_of, output_of);
+  std::cout << "done." << std::endl;
+
+  auto serial_forest_learner = gaml::bag::learner(learner,
+						  gaml::functor::average(),
+						  gaml::bag::functor::identity(),
+						  forest_size,true,
+						  1, seed);
+  std::cout << "Learning the same forest with 1 thread... " << std::flush;
+  auto serial_forest = serial_forest_learner(basis.begin(), basis.end(), input_of, output_of);
+  std::cout << "done." << std::endl
+	    << "  " << nb_differences(forest, serial_forest) << " differences between the two forests." << std::endl;
+
+  // The forest can be compiled into flat arrays, which are faster to
+  // walk, and saved in a binary file. Loading maps the file in
+  // memory, nothing is parsed.
+  std::ofstream bfile("forest.bin", std::ios::binary);
+  gaml::xtree::binary::write(bfile, gaml::xtree::flatten(forest));
+  bfile.close();
+  auto flat_forest = gaml::xtree::binary::load_forest<X,Y>("forest.bin", gaml::functor::average());
+  std::cout << "The forest is saved in forest.bin and loaded back." << std::endl
+	    << "  " << nb_differences(forest, flat_forest) << " differences between the loaded forest and the original one." << std::endl;
+  
+
+  // This does the plotting
+
+
+  std::cout << std::endl
+  	    << "Plotting..." << std::endl
+  	    << std::endl;
+
+  std::ofstream samples("samples.data");
+  for(auto& xy : basis)
+    samples << xy.first[0] << ' ' << xy.first[1] << ' ' << xy.second << std::endl;
+  samples.close();
+
+  {
+    std::ofstream data("flat-forest.data");
+    X input;
+    double& x0 = input[0];
+    double& x1 = input[1];
+    for(x0 = XMIN; x0 <= XMAX; x0 += PLOT_STEP, data << std::endl)
+      for(x1 = XMIN; x1 <= XMAX; x1 += PLOT_STEP)
+  	data << x0 << ' ' << x1 << ' ' << flat_forest(input) << std::endl;
+    data.close();
+
+    std::ofstream plot("flat-forest.plot");
+    plot << "set hidden3d" << std::endl
+  	 << "set ticslevel 0" << std::endl
+  	 << "splot 'flat-forest.data' with lines, 'samples.data' pt 7 ps .5" << std::endl;
+    plot.close();
+    std::cout << "gnuplot -p flat-forest.plot" << std::endl;
+  }
+
+
+  return 0;
+}
@@ -27,6 +27,9 @@
 
 #include <gamlxtreeInternals.hpp>
 #include <gamlxtreePredictor.hpp>
+#include <gamlxtreeColumnar.hpp>
+#include <gamlxtreeFlat.hpp>
+#include <gamlxtreeBinary.hpp>
 #include <gamlxtreeClassificationInternals.hpp>
 #include <gamlxtreeClassification.hpp>
 #include <gamlxtreeRegressionInternals.hpp>
@@ -35,6 +38,7 @@
 /**
  * @example example-001-classification.cpp
  * @example example-002-regression.cpp
+ * @example example-003-columnar-regression.cpp
  */
 
 /**
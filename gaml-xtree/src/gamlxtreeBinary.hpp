@@ -0,0 +1,393 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2014,  Supelec
+ * 
+ *   Author : Hervé Frezza-Buet
+ * 
+ *   Contributor :
+ * 
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ * 
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ * 
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ *   Contact : herve.frezza-buet@supelec.fr
+ * 
+ */
+
+#include <gamlxtreeFlat.hpp>
+#include <map>
+#include <vector>
+#include <string>
+#include <memory>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <array>
+
+namespace gaml {
+  namespace xtree {
+
+    /**
+     * This is a binary format for the flattened trees (see
+     * gaml::xtree::flatten). The file is made of a header followed by
+     * the flat arrays, stored as they are in memory, each one being
+     * aligned on 8 bytes:
+     *
+     * - node_offsets : nb_trees+1 32 bits unsigned integers,
+     * - leaf_offsets : nb_trees+1 32 bits unsigned integers,
+     * - nodes        : nb_nodes xtree::internal::FlatNode,
+     * - leaves       : nb_leaves*leaf_size doubles,
+     * - labels       : nb_labels labels of label_size bytes.
+     *
+     * A file is loaded by mapping it in memory, the predictors then
+     * read the arrays from the mapping, so that nothing is parsed nor
+     * copied. A range of trees can be loaded, only the pages of
+     * these trees are then read from the disk.
+     *
+     * The file is native: it can only be read on a platform with the
+     * same byte order and the same FlatNode layout. The offsets, the
+     * children of the nodes of the loaded trees and the leaf sizes
+     * (and the tested attributes, when the input size is known at
+     * compile time) are checked at load time, so that a truncated or
+     * corrupted file is rejected rather than read out of its bounds.
+     */
+    namespace binary {
+
+      constexpr std::uint32_t version    = 1;
+      constexpr std::uint32_t byte_order = 0x01020304;
+      constexpr char          magic[8]   = {'g','a','m','l','x','t','r','f'};
+
+      struct Header {
+	char          magic[8];
+	std::uint32_t version;
+	std::uint32_t byte_order;
+	std::uint32_t node_size;
+	std::uint32_t leaf_size;
+	std::uint32_t label_size;
+	std::uint32_t nb_labels;
+	std::uint32_t nb_trees;
+	std::uint32_t reserved;
+	std::uint64_t nb_nodes;
+	std::uint64_t nb_leaves;
+      };
+
+      /**
+       * This tells how the leaf values are encoded as leaf_size
+       * doubles. Regression leaves are a single double.
+       */
+      template<typename Y>
+      class Leaves {
+      public:
+	typedef char label_type;
+
+	Leaves(const std::vector<Y>& leaves) {}
+	Leaves() {}
+	std::uint32_t leaf_size() const {return 1;}
+	std::vector<label_type> labels() const {return {};}
+	void encode(const Y& value, double* row) const {row[0] = value;}
+	static const double& decode(const double* row, const label_type* labels, std::uint32_t nb_labels) {return row[0];}
+      };
+
+      /**
+       * Classification leaves (frequency maps) are encoded as the
+       * frequencies of all the labels, the labels being stored once in
+       * the label table. The labels thus have to be trivially
+       * copyable.
+       */
+      template<typename LABEL, typename COMP>
+      class Leaves<std::map<LABEL,double,COMP>> {
+      private:
+	std::map<LABEL,unsigned int,COMP> ids;
+
+      public:
+	typedef LABEL label_type;
+	static_assert(std::is_trivially_copyable<LABEL>::value, "gaml::xtree::binary : labels have to be trivially copyable.");
+
+	Leaves(const std::vector<std::map<LABEL,double,COMP>>& leaves) : ids() {
+	  for(auto& leaf : leaves)
+	    for(auto& kv : leaf)
+	      ids.emplace(kv.first, 0);
+	  unsigned int id = 0;
+	  for(auto& kv : ids)
+	    kv.second = id++;
+	}
+	Leaves() : ids() {}
+
+	std::uint32_t leaf_size() const {return ids.size();}
+	std::vector<label_type> labels() const {
+	  std::vector<label_type> res;
+	  for(auto& kv : ids)
+	    res.push_back(kv.first);
+	  return res;
+	}
+	void encode(const std::map<LABEL,double,COMP>& value, double* row) const {
+	  std::fill(row, row + ids.size(), 0);
+	  for(auto& kv : value)
+	    row[ids.find(kv.first)->second] = kv.second;
+	}
+	static std::map<LABEL,double,COMP> decode(const double* row, const label_type* labels, std::uint32_t nb_labels) {
+	  std::map<LABEL,double,COMP> res;
+	  for(std::uint32_t l = 0; l < nb_labels; ++l)
+	    if(row[l] != 0)
+	      res.emplace_hint(res.end(), labels[l], row[l]);
+	  return res;
+	}
+      };
+
+      namespace internal {
+	template<typename T> using test_tuple_size = void;
+
+	/**
+	 * This is the number of attributes of the inputs when it is
+	 * known at compile time (e.g. std::array), and 0 otherwise.
+	 */
+	template<typename X, typename = void>
+	struct dimension_of : std::integral_constant<unsigned int, 0> {};
+
+	template<typename X>
+	struct dimension_of<X, test_tuple_size<decltype(std::tuple_size<X>::value)> >
+	  : std::integral_constant<unsigned int, (unsigned int)(std::tuple_size<X>::value)> {};
+
+	inline void pad(std::ostream& os) {
+	  static const char zeros[8] = {0,0,0,0,0,0,0,0};
+	  auto pos = (std::uint64_t)os.tellp();
+	  if(pos % 8 != 0)
+	    os.write(zeros, 8 - pos % 8);
+	}
+
+	inline std::uint64_t padded(std::uint64_t size) {
+	  return (size + 7) / 8 * 8;
+	}
+      }
+
+      /**
+       * These are flattened trees read from a mapped binary file. It
+       * can be used as the TREES storage of gaml::xtree::FlatPredictor
+       * and gaml::xtree::FlatForest.
+       */
+      template<typename Y>
+      class Mapped {
+      public:
+	typedef typename Leaves<Y>::label_type label_type;
+
+      private:
+	std::shared_ptr<gaml::MappedFile>     file;
+	xtree::internal::FlatNodes            view;
+	const std::uint32_t*                  leaf_offsets;
+	const double*                         leaves;
+	std::uint32_t                         leaf_size;
+	const label_type*                     labels;
+	std::uint32_t                         nb_labels;
+
+      public:
+	/**
+	 * This maps the file, and keeps the trees of rank first to
+	 * first+nb-1. All the trees after first are kept if nb is 0. It
+	 * throws if no tree is kept. If dimension is not 0, the
+	 * attributes tested by the nodes are checked to be lower than it.
+	 */
+	Mapped(const std::string& path, unsigned int first, unsigned int nb, unsigned int dimension = 0)
+	  : file(std::make_shared<gaml::MappedFile>(path)), view(),
+	    leaf_offsets(nullptr), leaves(nullptr), leaf_size(0), labels(nullptr), nb_labels(0) {
+	  static_assert(sizeof(unsigned int) == sizeof(std::uint32_t), "gaml::xtree::binary : unsigned int has to be 32 bits.");
+	  if(file->size() < sizeof(Header))
+	    throw std::runtime_error("gaml::xtree::binary::load : the file is too small.");
+	  const Header& h = *((const Header*)(file->data()));
+	  if(std::memcmp(h.magic, magic, 8) != 0)
+	    throw std::runtime_error("gaml::xtree::binary::load : this is not a gaml xtree binary file.");
+	  if(h.version != version)
+	    throw std::runtime_error("gaml::xtree::binary::load : unsupported version.");
+	  if(h.byte_order != byte_order || h.node_size != sizeof(xtree::internal::FlatNode))
+	    throw std::runtime_error("gaml::xtree::binary::load : the file was written on an incompatible platform.");
+	  if(h.label_size != (h.nb_labels == 0 ? 0 : sizeof(label_type)) || (h.nb_labels != 0 && h.leaf_size != h.nb_labels))
+	    throw std::runtime_error("gaml::xtree::binary::load : the leaves do not match the output type.");
+
+	  if(h.nb_labels == 0 && h.leaf_size != Leaves<Y>().leaf_size())
+	    throw std::runtime_error("gaml::xtree::binary::load : the leaves do not match the output type.");
+	  // This rejects the sizes whose products below would overflow.
+	  if(h.nb_nodes > file->size() / sizeof(xtree::internal::FlatNode)
+	     || h.leaf_size == 0 || h.nb_leaves > file->size() / (h.leaf_size * sizeof(double))
+	     || (std::uint64_t)(h.nb_trees) + 1 > file->size() / sizeof(std::uint32_t))
+	    throw std::runtime_error("gaml::xtree::binary::load : the file is truncated.");
+
+	  std::uint64_t offsets_pos = internal::padded(sizeof(Header));
+	  std::uint64_t leaf_offsets_pos = offsets_pos + internal::padded(((std::uint64_t)(h.nb_trees) + 1) * sizeof(std::uint32_t));
+	  std::uint64_t nodes_pos  = leaf_offsets_pos + internal::padded(((std::uint64_t)(h.nb_trees) + 1) * sizeof(std::uint32_t));
+	  std::uint64_t leaves_pos = nodes_pos  + internal::padded(h.nb_nodes * sizeof(xtree::internal::FlatNode));
+	  std::uint64_t labels_pos = leaves_pos + internal::padded(h.nb_leaves * h.leaf_size * sizeof(double));
+	  if(file->size() < labels_pos + h.nb_labels * h.label_size)
+	    throw std::runtime_error("gaml::xtree::binary::load : the file is truncated.");
+	  if(first > h.nb_trees || nb > h.nb_trees - first)
+	    throw std::runtime_error("gaml::xtree::binary::load : the tree range exceeds the number of trees.");
+	  if(nb == 0)
+	    nb = h.nb_trees - first;
+	  // The forests merge the outputs of at least one tree.
+	  if(nb == 0)
+	    throw std::runtime_error("gaml::xtree::binary::load : no tree is selected.");
+	  check((const std::uint32_t*)(file->data() + offsets_pos), (const std::uint32_t*)(file->data() + leaf_offsets_pos),
+		(const xtree::internal::FlatNode*)(file->data() + nodes_pos), h, first, nb, dimension);
+
+	  view         = xtree::internal::FlatNodes((const xtree::internal::FlatNode*)(file->data() + nodes_pos),
+						    (const unsigned int*)(file->data() + offsets_pos) + first,
+						    nb);
+	  leaf_offsets = (const std::uint32_t*)(file->data() + leaf_offsets_pos) + first;
+	  leaves       = (const double*)(file->data() + leaves_pos);
+	  leaf_size    = h.leaf_size;
+	  labels       = (const label_type*)(file->data() + labels_pos);
+	  nb_labels    = h.nb_labels;
+	}
+
+	unsigned int size() const {return view.nb_trees;}
+	const xtree::internal::FlatNodes& trees() const {return view;}
+
+	decltype(auto) leaf(unsigned int t, int child) const {
+	  return Leaves<Y>::decode(row(t, child), labels, nb_labels);
+	}
+
+	/**
+	 * @returns the sum of the leaf values reached by all the trees,
+	 * cursors[t] being the leaf child code reached by tree t. The
+	 * leaf rows are summed in a buffer, and decoded once.
+	 */
+	decltype(auto) sum_leaves(const int* cursors) const {
+	  thread_local std::vector<double> sum;
+	  sum.assign(leaf_size, 0);
+	  for(unsigned int t = 0; t < view.nb_trees; ++t) {
+	    const double* r = row(t, cursors[t]);
+	    for(std::uint32_t l = 0; l < leaf_size; ++l)
+	      sum[l] += r[l];
+	  }
+	  return Leaves<Y>::decode(sum.data(), labels, nb_labels);
+	}
+
+      private:
+	const double* row(unsigned int t, int child) const {
+	  return leaves + (std::uint64_t)(leaf_offsets[t] + xtree::internal::leaf_rank(child)) * leaf_size;
+	}
+
+	// The offsets are non decreasing and within the arrays, and the
+	// children of the nodes of the trees [first, first+nb) are
+	// either nodes of higher rank (so that a walk ends) or leaves
+	// of their tree.
+	static void check(const std::uint32_t* node_offsets, const std::uint32_t* leaf_offsets,
+			  const xtree::internal::FlatNode* nodes, const Header& h,
+			  unsigned int first, unsigned int nb, unsigned int dimension) {
+	  for(std::uint32_t t = 0; t <= h.nb_trees; ++t)
+	    if(node_offsets[t] > h.nb_nodes || leaf_offsets[t] > h.nb_leaves
+	       || (t > 0 && (node_offsets[t] < node_offsets[t-1] || leaf_offsets[t] < leaf_offsets[t-1])))
+	      throw std::runtime_error("gaml::xtree::binary::load : the tree offsets are corrupted.");
+	  for(unsigned int t = first; t < first + nb; ++t) {
+	    std::uint32_t nb_nodes  = node_offsets[t+1] - node_offsets[t];
+	    std::uint32_t nb_leaves = leaf_offsets[t+1] - leaf_offsets[t];
+	    if(nb_leaves == 0)
+	      throw std::runtime_error("gaml::xtree::binary::load : a tree has no leaf.");
+	    for(std::uint32_t n = 0; n < nb_nodes; ++n) {
+	      const xtree::internal::FlatNode& node = nodes[node_offsets[t] + n];
+	      if(dimension != 0 && node.attr >= dimension)
+		throw std::runtime_error("gaml::xtree::binary::load : a node tests an attribute beyond the input dimension.");
+	      for(int child : {node.pass, node.fail})
+		if(child >= 0 ? (child <= (int)n || (std::uint32_t)child >= nb_nodes) : xtree::internal::leaf_rank(child) >= nb_leaves)
+		  throw std::runtime_error("gaml::xtree::binary::load : the tree nodes are corrupted.");
+	    }
+	  }
+	}
+      };
+
+      /**
+       * This writes flattened trees in the binary format. The stream
+       * has to be opened in binary mode.
+       */
+      template<typename Y>
+      void write(std::ostream& os, const xtree::internal::Flat<Y>& flat) {
+	Leaves<Y> codec(flat.leaves);
+	auto labels = codec.labels();
+
+	Header h;
+	std::memset(&h, 0, sizeof(Header));
+	std::memcpy(h.magic, magic, 8);
+	h.version    = version;
+	h.byte_order = byte_order;
+	h.node_size  = sizeof(xtree::internal::FlatNode);
+	h.leaf_size  = codec.leaf_size();
+	h.label_size = labels.size() == 0 ? 0 : sizeof(typename Leaves<Y>::label_type);
+	h.nb_labels  = labels.size();
+	h.nb_trees   = flat.size();
+	h.nb_nodes   = flat.nodes.size();
+	h.nb_leaves  = flat.leaves.size();
+
+	os.write((const char*)(&h), sizeof(Header));
+	internal::pad(os);
+	os.write((const char*)(flat.node_offsets.data()), flat.node_offsets.size() * sizeof(unsigned int));
+	internal::pad(os);
+	os.write((const char*)(flat.leaf_offsets.data()), flat.leaf_offsets.size() * sizeof(unsigned int));
+	internal::pad(os);
+	for(auto& node : flat.nodes) {
+	  // The padding bytes of the nodes are written as zeros.
+	  xtree::internal::FlatNode n;
+	  std::memset(&n, 0, sizeof(xtree::internal::FlatNode));
+	  n.threshold = node.threshold;
+	  n.attr      = node.attr;
+	  n.pass      = node.pass;
+	  n.fail      = node.fail;
+	  os.write((const char*)(&n), sizeof(xtree::internal::FlatNode));
+	}
+	internal::pad(os);
+	std::vector<double> row(h.leaf_size);
+	for(auto& leaf : flat.leaves) {
+	  codec.encode(leaf, row.data());
+	  os.write((const char*)(row.data()), row.size() * sizeof(double));
+	}
+	internal::pad(os);
+	if(labels.size() > 0)
+	  os.write((const char*)(labels.data()), labels.size() * sizeof(typename Leaves<Y>::label_type));
+	if(!os)
+	  throw std::runtime_error("gaml::xtree::binary::write : writing failed.");
+      }
+
+      template<typename X, typename Y>
+      void write(std::ostream& os, const FlatPredictor<X,Y>& tree) {
+	write(os, *(tree.flat));
+      }
+
+      template<typename X, typename Y, typename MergeOutput>
+      void write(std::ostream& os, const FlatForest<X,Y,MergeOutput>& forest) {
+	write(os, *(forest.flat));
+      }
+
+      /**
+       * This loads the tree of rank rank of a binary file.
+       */
+      template<typename X, typename Y>
+      FlatPredictor<X,Y,Mapped<Y>> load_tree(const std::string& path, unsigned int rank = 0) {
+	return FlatPredictor<X,Y,Mapped<Y>>(std::make_shared<Mapped<Y>>(path, rank, 1, internal::dimension_of<X>::value));
+      }
+
+      /**
+       * This loads a forest from a binary file.
+       * @param merge The merging of the tree predictions, as for gaml::bag::Predictor.
+       * @param width The number of trees walked together (see gaml::xtree::FlatForest).
+       * @param first,nb Only the trees of rank first to first+nb-1 are used. All the trees after first are used if nb is 0.
+       */
+      template<typename X, typename Y, typename MergeOutput>
+      FlatForest<X,Y,MergeOutput,Mapped<Y>> load_forest(const std::string& path, const MergeOutput& merge,
+							unsigned int width = 8,
+							unsigned int first = 0, unsigned int nb = 0) {
+	return FlatForest<X,Y,MergeOutput,Mapped<Y>>(std::make_shared<Mapped<Y>>(path, first, nb, internal::dimension_of<X>::value), merge, width);
+      }
+    }
+  }
+}
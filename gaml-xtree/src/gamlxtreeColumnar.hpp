@@ -0,0 +1,348 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2014,  Supelec
+ *
+ *   Author : Hervé Frezza-Buet
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : herve.frezza-buet@supelec.fr
+ *
+ */
+
+#include <gamlxtreeInternals.hpp>
+#include <vector>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+
+namespace gaml {
+  namespace xtree {
+    namespace internal {
+
+      /**
+       * This is a column-major copy of the inputs of a data set. The
+       * value of attribute a for sample i is column(a)[i]. VALUE may
+       * be float in order to halve the memory footprint.
+       */
+      template<typename VALUE>
+      class Columns {
+      public:
+	typedef VALUE value_type;
+	
+	std::size_t nb_samples;
+	std::size_t nb_attributes;
+	std::vector<VALUE> values;
+
+	template<typename DataIterator, typename InputOf>
+	Columns(const DataIterator& begin, const DataIterator& end, const InputOf& input_of)
+	  : nb_samples(std::distance(begin,end)), nb_attributes(0), values() {
+	  if(nb_samples == 0)
+	    return;
+	  const auto& x0 = input_of(*begin);
+	  nb_attributes = std::distance(x0.begin(),x0.end());
+	  values.resize(nb_samples * nb_attributes);
+	  std::size_t i = 0;
+	  for(auto it = begin; it != end; ++it, ++i) {
+	    const auto& x = input_of(*it);
+	    VALUE* v = values.data() + i;
+	    for(auto attr_it = x.begin(); attr_it != x.end(); ++attr_it, v += nb_samples)
+	      *v = (VALUE)(*attr_it);
+	  }
+	}
+
+	const VALUE* column(unsigned int a) const {return values.data() + a * nb_samples;}
+      };
+
+      /**
+       * The trees compare the inputs themselves (e.g. double) to the
+       * thresholds, whereas the columnar builder compares values
+       * rounded to VALUE (e.g. float). This returns a threshold t'
+       * such that x < t' if and only if VALUE(x) < t, for any
+       * double x, so that a tree splits the samples at prediction as
+       * the builder did.
+       */
+      template<typename VALUE>
+      using is_narrower_than_double = std::integral_constant<bool,
+							     std::is_floating_point<VALUE>::value
+							     && (std::numeric_limits<VALUE>::digits < std::numeric_limits<double>::digits)>;
+
+      template<typename VALUE>
+      double input_threshold(double t, std::false_type) {
+	return t;
+      }
+
+      template<typename VALUE>
+      double input_threshold(double t, std::true_type) {
+	// VALUE(x) < t means that VALUE(x) is at most a, the greatest
+	// VALUE below t, i.e. that x is below the midpoint of a and of
+	// the next VALUE b (rounding to nearest). The midpoint is a
+	// double, x equal to it is rounded to a or b (to even).
+	VALUE a = (VALUE)t;
+	if((double)a >= t)
+	  a = std::nextafter(a, std::numeric_limits<VALUE>::lowest());
+	VALUE b = std::nextafter(a, std::numeric_limits<VALUE>::max());
+	double middle = ((double)a + (double)b) / 2;
+	if((VALUE)middle == a)
+	  return std::nextafter(middle, std::numeric_limits<double>::max());
+	return middle;
+      }
+
+      template<typename VALUE>
+      double input_threshold(double t) {
+	return input_threshold<VALUE>(t, is_narrower_than_double<VALUE>());
+      }
+
+      /**
+       * This scores a test on a range of sample indices. By default,
+       * the SCORE template is used, with iterators on indices. It is
+       * specialized for the scores which can be computed faster from
+       * label ids in [0, nb_labels).
+       */
+      template<template<typename,typename,typename> class SCORE>
+      class ColumnarScore {
+      public:
+	ColumnarScore(unsigned int nb_labels) {}
+	
+	template<typename IndexIterator, typename Test, typename LabelOf>
+	double operator()(const IndexIterator& begin, const IndexIterator& end, const Test& test, const LabelOf& label_of) {
+	  SCORE<IndexIterator, Test, LabelOf> score;
+	  return score(begin, end, test, label_of);
+	}
+      };
+
+      /**
+       * The normalized information gain is computed from label
+       * counts rather than from frequency maps of splitted views.
+       */
+      template<>
+      class ColumnarScore<gaml::score::NormalizedInformationGain> {
+      private:
+	std::vector<double> counts;
+	std::vector<double> counts_true;
+
+	static double entropy(const std::vector<double>& c, double n) {
+	  double H = 0;
+	  for(auto count : c)
+	    if(count > 0) {
+	      double p = count / n;
+	      H -= p*std::log2(p);
+	    }
+	  return H;
+	}
+	
+      public:
+	ColumnarScore(unsigned int nb_labels) : counts(nb_labels), counts_true(nb_labels) {}
+	
+	template<typename IndexIterator, typename Test, typename LabelOf>
+	double operator()(const IndexIterator& begin, const IndexIterator& end, const Test& test, const LabelOf& label_of) {
+	  std::fill(counts.begin(),      counts.end(),      0);
+	  std::fill(counts_true.begin(), counts_true.end(), 0);
+	  double size      = 0;
+	  double size_true = 0;
+	  for(auto it = begin; it != end; ++it, ++size) {
+	    auto l = label_of(*it);
+	    ++counts[l];
+	    if(test(*it)) {
+	      ++counts_true[l];
+	      ++size_true;
+	    }
+	  }
+	  double size_false = size - size_true;
+
+	  double Hc = entropy(counts, size);
+	  double Hct_true = entropy(counts_true, size_true);
+	  for(unsigned int l = 0; l < counts.size(); ++l) counts[l] -= counts_true[l];
+	  double Hct_false = entropy(counts, size_false);
+
+	  double p_true  = size_true/size;
+	  double p_false = size_false/size;
+	  double Ht  = - p_true*std::log2(p_true) - p_false*std::log2(p_false);
+	  double Hct = p_true * Hct_true + p_false * Hct_false;
+	  double Ict = Hc - Hct;
+	  
+	  return 2*Ict/(Hc+Ht);
+	}
+      };
+
+      /**
+       * This builds the same kind of trees as build_tree, but the
+       * inputs are read from a Columns block and the nodes are built
+       * on ranges of sample indices, which are partitioned in place
+       * when a node is split. Sample i has the output outputs[i],
+       * from which the leaves are built, and the label labels[i],
+       * from which the splits are scored.
+       */
+      template<typename X, typename Y,
+	       template<typename,typename,typename>                   class SCORE,
+	       typename RANDOM_DEVICE,
+	       template<typename,typename,typename,typename,typename> class MakeLeaf,
+	       typename VALUE, typename OUTPUT, typename LABEL>
+      class ColumnarBuilder {
+      private:
+
+	typedef std::vector<unsigned int>::iterator index_iterator;
+	
+	const Columns<VALUE>&       columns;
+	const std::vector<OUTPUT>&  outputs;
+	const std::vector<LABEL>&   labels;
+	unsigned int                nmin;
+	unsigned int                k;
+	RANDOM_DEVICE&              rd;
+	ColumnarScore<SCORE>        score;
+	std::vector<unsigned int>   non_constant_attr;
+
+	// The samples of [begin, end) do not all have the same label
+	// and the non constant attributes are stored.
+	bool should_split(const index_iterator& begin, const index_iterator& end) {
+	  if(std::distance(begin,end) < (std::ptrdiff_t)nmin)
+	    return false;
+
+	  const LABEL& l0 = labels[*begin];
+	  auto it = begin;
+	  for(++it; it != end && labels[*it] == l0; ++it);
+	  if(it == end)
+	    return false;
+
+	  non_constant_attr.clear();
+	  for(unsigned int a = 0; a < columns.nb_attributes; ++a) {
+	    const VALUE* col = columns.column(a);
+	    VALUE v0 = col[*begin];
+	    for(it = begin + 1; it != end && col[*it] == v0; ++it);
+	    if(it != end)
+	      non_constant_attr.push_back(a);
+	  }
+	  return non_constant_attr.size() > 0;
+	}
+
+      public:
+
+	ColumnarBuilder(const Columns<VALUE>& columns,
+			const std::vector<OUTPUT>& outputs,
+			const std::vector<LABEL>& labels,
+			unsigned int nb_labels,
+			unsigned int nmin, unsigned int k,
+			RANDOM_DEVICE& rd)
+	  : columns(columns), outputs(outputs), labels(labels),
+	    nmin(nmin), k(k), rd(rd), score(nb_labels), non_constant_attr() {}
+
+	std::shared_ptr<Tree<X,Y>> operator()(const index_iterator& begin, const index_iterator& end) {
+	  auto label_of  = [this](unsigned int i) -> const LABEL&  {return labels[i];};
+	  
+	  if(should_split(begin,end)) {
+	    unsigned int K = std::min(k,(unsigned int)non_constant_attr.size());
+	    std::shuffle(non_constant_attr.begin(),non_constant_attr.end(), rd);
+
+	    double best_score = std::numeric_limits<double>::lowest();
+	    ThresholdTest<X> best_test;
+	    for(auto attr_it = non_constant_attr.begin(); attr_it != non_constant_attr.begin() + K; ++attr_it) {
+	      unsigned int a = *attr_it;
+	      const VALUE* col = columns.column(a);
+	      
+	      VALUE min = col[*begin];
+	      VALUE max = min;
+	      for(auto it = begin + 1; it != end; ++it) {
+		VALUE v = col[*it];
+		if(v < min)      min = v;
+		else if(v > max) max = v;
+	      }
+	      
+	      std::uniform_real_distribution<double> uniform(min, max);
+	      double threshold = uniform(rd);
+	      // As in build_tree, the threshold has to be greater than
+	      // the min, so that both sides of the split are non empty.
+	      while(threshold == min)
+		threshold = uniform(rd);
+	      // It still lies in (min, max] once adapted to the inputs.
+	      threshold = input_threshold<VALUE>(threshold);
+
+	      auto test = [col, threshold](unsigned int i) -> bool {return col[i] < threshold;};
+	      double s = score(begin, end, test, label_of);
+	      if(s > best_score) {
+		best_score = s;
+		best_test  = ThresholdTest<X>(threshold, a);
+	      }
+	    }
+
+	    const VALUE* col = columns.column(best_test.attr);
+	    double threshold = best_test.threshold;
+	    auto middle = std::partition(begin, end, [col, threshold](unsigned int i) -> bool {return col[i] < threshold;});
+	    auto pass = (*this)(begin,  middle);
+	    auto fail = (*this)(middle, end);
+	    return make_node(best_test, pass, fail);
+	  }
+	  else {
+	    auto input_of  = [](unsigned int i) -> unsigned int {return i;};
+	    auto output_of = [this](unsigned int i) -> const OUTPUT& {return outputs[i];};
+	    MakeLeaf<X,Y,index_iterator,decltype(input_of),decltype(output_of)> make_leaf;
+	    return make_leaf(begin,end,input_of,output_of);
+	  }
+	}
+      };
+
+      /**
+       * This builds a tree from the data, as build_tree does, but the
+       * inputs are first copied into a column-major block of VALUE
+       * (see Columns), and the nodes are built on ranges of sample
+       * indices which are partitioned in place. VALUE can be float,
+       * in order to halve the memory used by the copy: the thresholds
+       * are then adapted so that the double inputs are split at
+       * prediction as their float copies were during learning (see
+       * input_threshold). The splits are scored from the labels of
+       * the outputs, given by label_of (e.g. class ids in [0,
+       * nb_labels) for classification).
+       */
+      template<typename X, typename Y,
+	       template<typename,typename,typename>                   class SCORE,
+	       typename RANDOM_DEVICE,
+	       template<typename,typename,typename,typename,typename> class MakeLeaf,
+	       typename VALUE,
+	       typename DataIterator, typename InputOf, typename OutputOf, typename LabelOf>
+      std::shared_ptr<Tree<X,Y>> build_columnar_tree(const DataIterator& begin, const DataIterator& end,
+						     const InputOf& input_of, const OutputOf& output_of,
+						     const LabelOf& label_of, unsigned int nb_labels,
+						     unsigned int nmin,
+						     unsigned int k,
+						     RANDOM_DEVICE& rd) {
+	typedef typename std::decay<decltype(output_of(*begin))>::type           output_type;
+	typedef typename std::decay<decltype(label_of(output_of(*begin)))>::type label_type;
+	Columns<VALUE> columns(begin, end, input_of);
+	std::vector<output_type> outputs;
+	std::vector<label_type>  labels;
+	outputs.reserve(columns.nb_samples);
+	labels.reserve(columns.nb_samples);
+	for(auto it = begin; it != end; ++it) {
+	  outputs.push_back(output_of(*it));
+	  labels.push_back(label_of(outputs.back()));
+	}
+
+	std::vector<unsigned int> indices(columns.nb_samples);
+	std::iota(indices.begin(), indices.end(), 0);
+	
+	ColumnarBuilder<X,Y,SCORE,RANDOM_DEVICE,MakeLeaf,VALUE,output_type,label_type> builder(columns, outputs, labels, nb_labels, nmin, k, rd);
+	return builder(indices.begin(), indices.end());
+      }
+    }
+  }
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2014,  Supelec
+ *
+ *   Author : Hervé Frezza-Buet
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : herve.frezza-buet@supelec.fr
+ *
+ */
+
+#include <gamlxtreePredictor.hpp>
+#include <memory>
+#include <vector>
+#include <numeric>
+#include <type_traits>
+
+namespace gaml {
+  namespace xtree {
+
+    template<typename T> using test_sum_leaves = void;
+
+    /**
+     * sums_leaves<TREES,MergeOutput>::type is std::true_type if the
+     * merge of the tree predictions is the cumulation of the label
+     * frequencies, and if TREES can sum the leaves reached by all the
+     * trees at once (see gaml::xtree::binary::Mapped). The merge is
+     * then applied to that sum only, which gives the same label.
+     */
+    template<typename TREES, typename MergeOutput, typename = void>
+    struct sums_leaves : std::false_type {};
+
+    template<typename TREES, typename VALUE>
+    struct sums_leaves<TREES, gaml::functor::highest_cumulated_frequency<VALUE>,
+		       test_sum_leaves<decltype(std::declval<const TREES&>().sum_leaves(std::declval<const int*>()))> > : std::true_type {};
+
+    /**
+     * This is a tree predictor compiled into flat arrays (see
+     * gaml::xtree::flatten). It gives the same predictions as the
+     * tree it comes from, without walking pointers nor calling
+     * virtual methods. The copies share the flat arrays. TREES is
+     * the storage of the arrays, which can also be a mapped file
+     * (see gaml::xtree::binary).
+     */
+    template<typename X, typename Y, typename TREES = internal::Flat<Y>>
+    class FlatPredictor {
+    public:
+
+      typedef X input_type;
+      typedef Y output_type;
+
+      std::shared_ptr<const TREES> flat;
+
+      FlatPredictor() : flat() {}
+      FlatPredictor(std::shared_ptr<const TREES> f) : flat(f) {}
+      FlatPredictor(const FlatPredictor& other) = default;
+      FlatPredictor& operator=(const FlatPredictor& other) = default;
+
+      output_type operator()(const input_type& x) const {
+	thread_local std::vector<double> buf;
+	return flat->leaf(0, flat->trees().walk(0, internal::attributes(x, buf)));
+      }
+    };
+
+    /**
+     * This is a forest compiled into flat arrays (see
+     * gaml::xtree::flatten). All the trees are walked for an input
+     * and the leaf values are merged, as gaml::bag::Predictor does.
+     * The trees are walked by groups of width trees, level by level
+     * (see gaml::xtree::internal::FlatNodes::walk_all), so that the
+     * memory accesses of several trees overlap. The copies share the
+     * flat arrays, which are stored by TREES (see FlatPredictor).
+     */
+    template<typename X, typename Y, typename MergeOutput, typename TREES = internal::Flat<Y>>
+    class FlatForest {
+    public:
+
+      typedef X                                  input_type;
+      typedef Y                                  elementary_output_type;
+      typedef typename MergeOutput::output_type output_type;
+
+      std::shared_ptr<const TREES> flat;
+      MergeOutput merge;
+      unsigned int width;
+
+      FlatForest() : flat(), merge(), width(1) {}
+      FlatForest(std::shared_ptr<const TREES> f, const MergeOutput& m, unsigned int w) : flat(f), merge(m), width(w) {}
+      FlatForest(const FlatForest& other) = default;
+      FlatForest& operator=(const FlatForest& other) = default;
+
+      output_type operator()(const input_type& x) const {
+	thread_local std::vector<double>       buf;
+	thread_local std::vector<int>          cursors;
+	thread_local std::vector<unsigned int> ranks;
+	unsigned int nb_trees = flat->size();
+	if(ranks.size() != nb_trees) {
+	  ranks.resize(nb_trees);
+	  std::iota(ranks.begin(), ranks.end(), 0);
+	}
+	cursors.resize(nb_trees);
+
+	flat->trees().walk_all(internal::attributes(x, buf), cursors.data(), width);
+	return merge_leaves(ranks, cursors, typename sums_leaves<TREES,MergeOutput>::type());
+      }
+
+    private:
+
+      output_type merge_leaves(const std::vector<unsigned int>& ranks, const std::vector<int>& cursors, std::false_type) const {
+	const TREES& f = *flat;
+	auto prediction_of = [&f, &cursors](unsigned int t) -> decltype(auto) {return f.leaf(t, cursors[t]);};
+	return merge(ranks.cbegin(), ranks.cend(), prediction_of);
+      }
+
+      output_type merge_leaves(const std::vector<unsigned int>& ranks, const std::vector<int>& cursors, std::true_type) const {
+	if(ranks.size() == 0)
+	  return merge_leaves(ranks, cursors, std::false_type());
+	auto sum = flat->sum_leaves(cursors.data());
+	auto prediction_of = [&sum](unsigned int) -> const decltype(sum)& {return sum;};
+	return merge(ranks.cbegin(), ranks.cbegin() + 1, prediction_of);
+      }
+    };
+
+    /**
+     * This compiles a tree predictor into a flat one.
+     */
+    template<typename X, typename Y>
+    FlatPredictor<X,Y> flatten(const Predictor<X,Y>& tree) {
+      auto flat = std::make_shared<internal::Flat<Y>>();
+      tree.flatten(*flat);
+      return FlatPredictor<X,Y>(flat);
+    }
+
+    /**
+     * This compiles a forest, i.e. a gaml::bag::Predictor of trees,
+     * into a flat one.
+     * @param width The number of trees walked together. 1 walks the trees one after the other.
+     */
+    template<typename MergeOutput, typename ElementaryPredictor>
+    FlatForest<typename ElementaryPredictor::input_type,
+	       typename ElementaryPredictor::output_type,
+	       MergeOutput> flatten(const gaml::bag::Predictor<MergeOutput,ElementaryPredictor>& forest, unsigned int width = 8) {
+      typedef typename ElementaryPredictor::input_type  X;
+      typedef typename ElementaryPredictor::output_type Y;
+      auto flat = std::make_shared<internal::Flat<Y>>();
+      for(auto& tree : forest.predictors)
+	tree.flatten(*flat);
+      return FlatForest<X,Y,MergeOutput>(flat, forest.merge, width);
+    }
+  }
+}
@@ -36,6 +36,7 @@
 #include <vector>
 #include <iterator>
 #include <random>
+#include <type_traits>
 #include <gaml.hpp>
 
 namespace gaml {
@@ -64,6 +65,180 @@ namespace gaml {
 	}
       };
 
+      /**
+       * This is a node of a flattened tree. The children are ranks in
+       * the node array of the tree when they are positive or null,
+       * and they code a rank in the leaf array of the tree otherwise
+       * (see leaf_child and leaf_rank).
+       */
+      struct FlatNode {
+	double       threshold;
+	unsigned int attr;
+	int          pass;
+	int          fail;
+      };
+
+      inline int          leaf_child(unsigned int rank) {return -1 - (int)rank;}
+      inline unsigned int leaf_rank(int child)          {return (unsigned int)(-1 - child);}
+
+      template<typename AttrIterator>
+      AttrIterator attributes(const AttrIterator& begin, const AttrIterator& end, std::vector<double>& buf, std::true_type) {
+	return begin;
+      }
+
+      template<typename AttrIterator>
+      std::vector<double>::const_iterator attributes(const AttrIterator& begin, const AttrIterator& end, std::vector<double>& buf, std::false_type) {
+	buf.clear();
+	std::copy(begin, end, std::back_inserter(buf));
+	return buf.cbegin();
+      }
+
+      /**
+       * This returns a random access iterator on the attributes of
+       * x. If the iterators of x are not random access ones, the
+       * attributes are copied into buf.
+       */
+      template<typename X>
+      auto attributes(const X& x, std::vector<double>& buf) {
+	typedef decltype(x.begin()) attr_iterator;
+	return attributes(x.begin(), x.end(), buf,
+			    typename std::is_base_of<std::random_access_iterator_tag,
+						     typename std::iterator_traits<attr_iterator>::iterator_category>::type());
+      }
+
+      /**
+       * This is a read-only view on the nodes of flattened trees. The
+       * nodes of tree t are nodes[node_offsets[t]] to
+       * nodes[node_offsets[t+1]-1]; the root of a tree is its first
+       * node, or its first leaf if it has no node. The arrays may be
+       * owned by a Flat, or lie in a mapped file.
+       */
+      class FlatNodes {
+      public:
+	const FlatNode*     nodes;
+	const unsigned int* node_offsets;
+	unsigned int        nb_trees;
+
+	FlatNodes() : nodes(nullptr), node_offsets(nullptr), nb_trees(0) {}
+	FlatNodes(const FlatNode* n, const unsigned int* offsets, unsigned int nb) : nodes(n), node_offsets(offsets), nb_trees(nb) {}
+
+	int root(unsigned int t) const {
+	  return node_offsets[t] == node_offsets[t+1] ? leaf_child(0) : 0;
+	}
+
+	/**
+	 * This walks tree t for the attributes x (a random access
+	 * iterator). @returns the child code of the reached leaf.
+	 */
+	template<typename AttrIterator>
+	int walk(unsigned int t, const AttrIterator& x) const {
+	  const FlatNode* tree_nodes = nodes + node_offsets[t];
+	  int n = root(t);
+	  while(n >= 0) {
+	    const FlatNode& nd = tree_nodes[n];
+	    n = x[nd.attr] < nd.threshold ? nd.pass : nd.fail;
+	  }
+	  return n;
+	}
+
+	/**
+	 * This walks all the trees for the attributes x, the leaf
+	 * child code of tree t is stored in cursors[t]. The trees are
+	 * walked by groups of width trees, all the trees of a group
+	 * being moved down by one level before the next level is
+	 * considered. This interleaving hides the memory latency of
+	 * the node fetches. A width of 1 walks the trees one after the
+	 * other.
+	 */
+	template<typename AttrIterator>
+	void walk_all(const AttrIterator& x, int* cursors, unsigned int width) const {
+	  if(width <= 1) {
+	    for(unsigned int t = 0; t < nb_trees; ++t)
+	      cursors[t] = walk(t, x);
+	    return;
+	  }
+
+	  for(unsigned int first = 0; first < nb_trees; first += width) {
+	    unsigned int last = std::min(first + width, nb_trees);
+	    for(unsigned int t = first; t < last; ++t)
+	      cursors[t] = root(t);
+	    bool active = true;
+	    while(active) {
+	      active = false;
+	      for(unsigned int t = first; t < last; ++t) {
+		int n = cursors[t];
+		if(n >= 0) {
+		  const FlatNode& nd = nodes[node_offsets[t] + n];
+		  n = x[nd.attr] < nd.threshold ? nd.pass : nd.fail;
+		  cursors[t] = n;
+		  active = active || n >= 0;
+		}
+	      }
+	    }
+	  }
+	}
+      };
+
+      /**
+       * This stores trees as flat arrays of nodes and leaves, which
+       * are walked without any pointer nor virtual call (see
+       * FlatNodes). The leaves of tree t are
+       * leaves[leaf_offsets[t]] to leaves[leaf_offsets[t+1]-1].
+       */
+      template<typename Y>
+      class Flat {
+      public:
+	typedef Y leaf_type;
+
+	std::vector<FlatNode>     nodes;
+	std::vector<Y>            leaves;
+	std::vector<unsigned int> node_offsets;
+	std::vector<unsigned int> leaf_offsets;
+
+	Flat() : nodes(), leaves(), node_offsets(1,0), leaf_offsets(1,0) {}
+
+	/**
+	 * @returns the number of trees.
+	 */
+	unsigned int size() const {return node_offsets.size() - 1;}
+
+	/**
+	 * This adds a node to the current tree, the children are set
+	 * afterwards. @returns the rank of the node in its tree.
+	 */
+	int add_node(unsigned int attr, double threshold) {
+	  nodes.push_back({threshold, attr, 0, 0});
+	  return (int)(nodes.size() - 1 - node_offsets.back());
+	}
+
+	/**
+	 * This adds a leaf to the current tree. @returns the child
+	 * code of the leaf.
+	 */
+	int add_leaf(const Y& value) {
+	  leaves.push_back(value);
+	  return leaf_child(leaves.size() - 1 - leaf_offsets.back());
+	}
+
+	FlatNode& node(unsigned int rank) {return nodes[node_offsets.back() + rank];}
+
+	/**
+	 * This closes the current tree, the next nodes and leaves
+	 * belong to a new tree.
+	 */
+	void close_tree() {
+	  node_offsets.push_back(nodes.size());
+	  leaf_offsets.push_back(leaves.size());
+	}
+
+	FlatNodes trees() const {return FlatNodes(nodes.data(), node_offsets.data(), size());}
+
+	/**
+	 * @returns the leaf value of tree t for the (leaf) child code.
+	 */
+	const Y& leaf(unsigned int t, int child) const {return leaves[leaf_offsets[t] + leaf_rank(child)];}
+      };
+
       template<typename X>
       class Test : public Serializable {
       public:
@@ -71,6 +246,12 @@ namespace gaml {
 	virtual ~Test() {}
 
 	virtual bool operator()(const X&) = 0;
+
+	/**
+	 * Tests which compare one attribute to a threshold can be
+	 * flattened. They set attr and threshold, and return true.
+	 */
+	virtual bool threshold_of(unsigned int& attr, double& threshold) const {return false;}
       };
 
       template<typename X, typename Y>
@@ -79,6 +260,12 @@ namespace gaml {
 	Tree() : Writeable() {}
 	virtual ~Tree() {}
 	virtual Y operator()(const X&) = 0;
+
+	/**
+	 * This appends the tree to the current tree of flat. @returns
+	 * the child code of the root.
+	 */
+	virtual int flatten(Flat<Y>& flat) const = 0;
       };
 
       template<typename X, typename Y, typename TEST>
@@ -110,6 +297,19 @@ namespace gaml {
 	     << *fail << std::endl
 	     << test;
 	}
+
+	virtual int flatten(Flat<Y>& flat) const {
+	  unsigned int attr;
+	  double threshold;
+	  if(!test.threshold_of(attr, threshold))
+	    throw std::runtime_error("gaml::xtree::internal::Node::flatten : the test is not a threshold test.");
+	  int rank = flat.add_node(attr, threshold);
+	  int p    = pass->flatten(flat);
+	  int f    = fail->flatten(flat);
+	  flat.node(rank).pass = p;
+	  flat.node(rank).fail = f;
+	  return rank;
+	}
       };
 
       
@@ -132,6 +332,11 @@ namespace gaml {
 	};
 	virtual void write_leaf(std::ostream& os) const = 0;
 	virtual void read_leaf(std::istream& is) = 0;
+	virtual const Y& leaf_value() const = 0;
+
+	virtual int flatten(Flat<Y>& flat) const {
+	  return flat.add_leaf(leaf_value());
+	}
       };
       
 
@@ -185,6 +390,11 @@ namespace gaml {
 	  std::advance(it,attr);
 	  return *it < threshold;
 	}
+	virtual bool threshold_of(unsigned int& a, double& thres) const {
+	  a     = attr;
+	  thres = threshold;
+	  return true;
+	}
 	virtual void write(std::ostream& os) const {
 	  os << threshold << ' ' << attr;
 	}
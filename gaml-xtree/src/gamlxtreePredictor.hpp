@@ -53,6 +53,14 @@ namespace gaml {
       }
       // This does the prediction.
       output_type operator()(const input_type& x) const {return (*tree)(x);}
+
+      /**
+       * This appends the tree as a new tree of flat (see gaml::xtree::flatten).
+       */
+      void flatten(internal::Flat<Y>& flat) const {
+	tree->flatten(flat);
+	flat.close_tree();
+      }
     };
   }
 }
@@ -27,6 +27,7 @@
 
 #include <gamlxtreePredictor.hpp>
 #include <gamlxtreeRegressionInternals.hpp>
+#include <gamlxtreeColumnar.hpp>
 
 namespace gaml {
   namespace xtree {
@@ -72,7 +73,12 @@ namespace gaml {
 	Learner(unsigned int min_set_size,
 		unsigned int nb_attr_test,
 		const RANDOM_DEVICE& rd) : nmin(min_set_size), k(nb_attr_test), rd(rd)  {}
-	
+
+	// See gaml::bag::reseed.
+	void reseed(std::seed_seq& seq) {
+	  rd.seed(seq);
+	}
+
 
 	template<typename DataIterator, typename InputOf, typename OutputOf>
 	predictor_type operator()(const DataIterator& begin, const DataIterator& end,
@@ -93,6 +99,55 @@ namespace gaml {
 				  const RANDOM_DEVICE& rd) {
 	return Learner<X,Y, SCORE, RANDOM_DEVICE>(min_set_size,nb_attr_test,rd);
       }
+
+      /**
+       * This learner builds the same kind of trees as Learner, much
+       * faster for large data sets (see
+       * xtree::internal::build_columnar_tree).
+       */
+      template<typename X, typename Y, template<typename,typename,typename> class SCORE,
+	       typename RANDOM_DEVICE, typename VALUE>
+      class ColumnarLearner {
+      public:
+	typedef regression::Predictor<X,Y> predictor_type;
+	unsigned int nmin;
+	unsigned int k;
+	mutable RANDOM_DEVICE rd;
+
+	ColumnarLearner() = delete;
+	ColumnarLearner(const ColumnarLearner&) = default;
+
+	ColumnarLearner(unsigned int min_set_size,
+			unsigned int nb_attr_test,
+			const RANDOM_DEVICE& rd) : nmin(min_set_size), k(nb_attr_test), rd(rd)  {}
+
+	// See gaml::bag::reseed.
+	void reseed(std::seed_seq& seq) {
+	  rd.seed(seq);
+	}
+
+	template<typename DataIterator, typename InputOf, typename OutputOf>
+	predictor_type operator()(const DataIterator& begin, const DataIterator& end,
+				  const InputOf& input_of, const OutputOf& output_of) const {
+	  auto label_of = [](double y) -> double {return y;};
+	  return predictor_type(xtree::internal::build_columnar_tree<X,Y,SCORE,RANDOM_DEVICE,
+				regression::internal::MakeLeaf,VALUE>(begin,end,input_of,output_of,label_of,0,nmin,k,rd));
+	}
+      };
+
+      /**
+       * This builds a extreme tree learner for regression, working on a column-major copy of the inputs.
+       * @param min_set_size If a split leads to a leaf with less that this amount of samples, it will not be splitted further.
+       * @param nb_attr_test At each split we test some of the attributes (with a single random threshold). This is the number of tested attributes.
+       */
+      template<typename X, typename Y, template<typename,typename,typename> class SCORE,
+	       typename VALUE = double,
+	       typename RANDOM_DEVICE>
+      ColumnarLearner<X,Y, SCORE, RANDOM_DEVICE, VALUE> columnar_learner(unsigned int min_set_size,
+									 unsigned int nb_attr_test,
+									 const RANDOM_DEVICE& rd) {
+	return ColumnarLearner<X,Y, SCORE, RANDOM_DEVICE, VALUE>(min_set_size,nb_attr_test,rd);
+      }
       
     }
   }
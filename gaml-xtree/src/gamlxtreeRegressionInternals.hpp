@@ -45,6 +45,10 @@ namespace gaml {
 	    return value;
 	  }
 
+	  virtual const double& leaf_value() const {
+	    return value;
+	  }
+
 	  virtual void write_leaf(std::ostream& os) const {
 	    os << value;
 	  }
@@ -59,7 +59,15 @@ struct UVXYparser : public gaml::BasicParser {
     // Let us test if more data are available in the file.
     return !is.eof();
   }
-  
+
+  // This is optional. It allows to index the file in parallel
+  // (see gaml::has_resync). From anywhere in the file, we reach the
+  // beginning of the next line.
+  bool resync(std::istream& is) const {
+    is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    return readSeparator(is);
+  }
+
   void write(std::ostream& os, const Data& data) const {
     os << data.u << ", " << data.v << ", " << data.x << ", " << data.y << ", " << data.z;
   }
@@ -41,6 +41,7 @@
 
 #define CUSTOMERS_DATA_FILE  "customers.data"
 #define CUSTOMERS_INDEX_FILE "customers.index"
+#define CUSTOMERS_MAPPED_INDEX_FILE "customers.mapped-index"
 int main(int argc, char** argv) {
   try {
     
@@ -96,6 +97,22 @@ int main(int argc, char** argv) {
       auto out = gaml::make_output_iterator (output_stream);
       std::reverse_copy(indexed.begin(), indexed.end(), out);
     }
+
+    // The files can also be mapped in memory. The values are then
+    // parsed directly from the mapped data, and the index is a mapped
+    // array of offsets (its format differs from the one of
+    // IndexedDataset). Iterators are cheap to copy, and random access
+    // involves no file seek.
+    auto mapped = gaml::make_mapped_indexed_dataset(parser,
+						    CUSTOMERS_DATA_FILE,
+						    CUSTOMERS_MAPPED_INDEX_FILE);
+    std::cout << std::endl
+	      << "All customers (mapped, reversed)" << std::endl
+	      << std::endl;
+    {
+      auto out = gaml::make_output_iterator (output_stream);
+      std::reverse_copy(mapped.begin(), mapped.end(), out);
+    }
   }
   
   catch (const std::exception& e) {
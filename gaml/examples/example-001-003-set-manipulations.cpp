@@ -203,6 +203,15 @@ int main(int argc, char* argv[]) {
   display("Cache demo [5..10[",  cached_squares.begin() +  5, cached_squares.begin() + 10);
   display("Cache demo [0..20[",  cached_squares.begin()     , cached_squares.end()       );
   display("Cache demo [10..20[", cached_squares.begin() + 10, cached_squares.begin() + 20);
+  std::cout << "Cache demo : " << cached_squares.stats().hits << " hits, "
+	    << cached_squares.stats().misses << " misses, "
+	    << cached_squares.stats().evictions << " evictions." << std::endl;
+
+  // The page to be evicted is chosen by a policy (see
+  // gaml::eviction). The default one keeps the most used pages, LRU
+  // or CLOCK can be used as well.
+  auto lru_squares = gaml::cache<gaml::eviction::LRU>(squares.begin(),squares.end(),7,2);
+  display("LRU cache demo [0..20[", lru_squares.begin(), lru_squares.end());
   
   // You can set up a custom transformation from one dataset to
   // another. Its is based on an index map. This is convinent, for
@@ -0,0 +1,62 @@
+/*
+ * About this tutorial :
+ *
+ * A gaml::SharedCache is a cache (see gamlCache.hpp) that several
+ * threads can read through at the same time. It is meant for the
+ * parallel algorithms (cross-validation folds, bagged learners) that
+ * work on the same collection, when computing or reading the values
+ * is expensive.
+ *
+ * The set manipulations (bootstrap, shuffle, partitions...) apply to
+ * a shared cache as to any random access collection. Here, several
+ * threads run shuffles and bootstraps of the same shared cache.
+ */
+
+#include <gaml.hpp>
+#include <string>
+#include <vector>
+#include <thread>
+#include <random>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+
+  // The collection is mapped, so that the values are computed when
+  // the pages are loaded in the cache.
+  auto numbers = gaml::map(gaml::integer(0), gaml::integer(1000),
+			   [](int i) -> std::string {return std::string("sample #") + std::to_string(i);});
+
+  // There are 5 pages of 64 values in the cache.
+  auto cache = gaml::shared_cache(numbers.begin(), numbers.end(), 64, 5);
+
+  // Each thread computes the number of characters in a shuffle and in
+  // a bootstrap of the cache.
+  unsigned int nb_threads = 4;
+  std::vector<std::size_t> shuffled(nb_threads, 0), bootstrapped(nb_threads, 0);
+  std::vector<std::thread> threads;
+  for(unsigned int t = 0; t < nb_threads; ++t)
+    threads.emplace_back([&cache, &shuffled, &bootstrapped, t]() {
+	std::mt19937 gen(t);
+	auto shuffle = gaml::shuffle(cache.begin(), cache.end(), gen);
+	for(auto& value : shuffle)
+	  shuffled[t] += value.size();
+	auto bootstrap = gaml::bootstrap(cache.begin(), cache.end(), 1000, gen);
+	for(auto& value : bootstrap)
+	  bootstrapped[t] += value.size();
+      });
+  for(auto& thread : threads)
+    thread.join();
+
+  for(unsigned int t = 0; t < nb_threads; ++t)
+    std::cout << "thread " << t << " : " << shuffled[t] << " characters in the shuffle, "
+	      << bootstrapped[t] << " in the bootstrap." << std::endl;
+
+  // The partitions apply as well.
+  auto kfold = gaml::partition::KFold(cache.begin(), cache.end(), 4);
+  for(unsigned int fold = 0; fold < kfold.size(); ++fold)
+    std::cout << "fold " << fold << " : first value is \"" << *(kfold.begin(fold)) << "\"." << std::endl;
+
+  auto stats = cache.stats();
+  std::cout << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions." << std::endl;
+  return 0;
+}
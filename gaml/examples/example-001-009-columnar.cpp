@@ -0,0 +1,95 @@
+/*
+ * About this tutorial :
+ *
+ * The columnar format (see gamlColumnar.hpp) stores numerical
+ * datasets in a compressed binary file. Each input attribute, and
+ * the output, is stored as a column of bit-packed values, so that a
+ * column of small integers takes a few bits per sample.
+ *
+ * The file is read by mapping it in memory, and any sample can be
+ * decoded without the others: the loaded dataset is a random access
+ * collection, and the set manipulations (shuffles, partitions...)
+ * apply to it.
+ */
+
+#include <gaml.hpp>
+#include <array>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <iostream>
+
+#define DATA_FILE  "samples.columnar"
+#define EMPTY_FILE "empty.columnar"
+
+typedef std::array<double,3>  X;
+typedef double                Y;
+typedef std::pair<X,Y>        Data;
+
+int main(int argc, char* argv[]) {
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_real_distribution<double> uniform(0, 1);
+
+  // The first attribute is an integer, the second one is exactly a
+  // float, the third one and the output are any double. Each column
+  // is thus encoded with a different codec.
+  std::vector<Data> samples;
+  for(unsigned int i = 0; i < 10000; ++i) {
+    double x = uniform(gen);
+    samples.push_back({{{(double)(i % 100), .25 * (i % 17), x}}, 3 * x - 1});
+  }
+
+  auto input_of  = [](const Data& d) -> const X& {return d.first;};
+  auto output_of = [](const Data& d) -> Y        {return d.second;};
+
+  {
+    std::ofstream file(DATA_FILE, std::ofstream::binary);
+    gaml::columnar::write(file, samples.begin(), samples.end(), input_of, output_of, 1024);
+  }
+
+  // Let us read the file back. The values are decoded when the
+  // samples are accessed.
+  auto dataset = gaml::columnar::load<X,Y>(DATA_FILE);
+  std::cout << dataset.size() << " samples of dimension " << dataset.dim() << " read from \"" << DATA_FILE << "\"." << std::endl;
+
+  unsigned int nb_differences = 0;
+  auto sample_it = samples.begin();
+  for(auto& data : dataset)
+    if(data != *(sample_it++))
+      ++nb_differences;
+  std::cout << nb_differences << " samples differ from the written ones." << std::endl;
+
+  // The loaded dataset can be shuffled and partitioned as any other
+  // random access collection.
+  auto shuffled = gaml::shuffle(dataset.begin(), dataset.end(), gen);
+  auto kfold    = gaml::partition::KFold(shuffled.begin(), shuffled.end(), 5);
+
+  // The first attribute, an integer, is summed over each fold and its
+  // complement. This gives the sum over the whole dataset.
+  double total = 0;
+  for(auto& data : dataset)
+    total += data.first[0];
+
+  for(unsigned int fold = 0; fold < kfold.size(); ++fold) {
+    double sum = 0;
+    for(auto it = kfold.begin(fold); it != kfold.end(fold); ++it)
+      sum += (*it).first[0];
+    for(auto it = kfold.complement_begin(fold); it != kfold.complement_end(fold); ++it)
+      sum += (*it).first[0];
+    std::cout << "fold " << fold << " : "
+	      << std::distance(kfold.begin(fold), kfold.end(fold)) << " test samples, "
+	      << std::distance(kfold.complement_begin(fold), kfold.complement_end(fold)) << " training samples, "
+	      << "sum " << sum << " (whole dataset : " << total << ")." << std::endl;
+  }
+
+  // An empty range can be written and read back as well.
+  {
+    std::ofstream file(EMPTY_FILE, std::ofstream::binary);
+    gaml::columnar::write(file, samples.end(), samples.end(), input_of, output_of);
+  }
+  auto empty = gaml::columnar::load<X,Y>(EMPTY_FILE);
+  std::cout << empty.size() << " samples read from \"" << EMPTY_FILE << "\"." << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * About this tutorial :
+ *
+ * The statistics of a collection (averages, variances, frequencies)
+ * can be computed by accumulators (see gaml::statistics). Several
+ * accumulators can be fed in a single pass over the collection, which
+ * matters when the elements are expensive to get (parsed from a file,
+ * computed by a map...).
+ *
+ * When the collection is random access, the pass can be split among
+ * several threads. The accumulators of the chunks are then merged.
+ */
+
+#include <gaml.hpp>
+#include <vector>
+#include <string>
+#include <random>
+#include <iostream>
+
+typedef std::pair<double,std::string> Data;
+
+int main(int argc, char* argv[]) {
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::normal_distribution<double> normal(10, 2);
+  std::uniform_int_distribution<int> dice(1, 6);
+
+  // The samples are a height and a label.
+  std::vector<Data> samples;
+  for(unsigned int i = 0; i < 100000; ++i) {
+    int d = dice(gen);
+    samples.push_back({normal(gen), d == 6 ? "tall" : (d == 1 ? "short" : "medium")});
+  }
+
+  auto height_of = [](const Data& d) -> double             {return d.first;};
+  auto square_of = [](const Data& d) -> double             {return d.first * d.first;};
+  auto label_of  = [](const Data& d) -> const std::string& {return d.second;};
+
+  // The moments of the heights and of their squares, as well as the
+  // frequencies of the labels, are computed in a single pass.
+  auto [heights, squares, labels] = gaml::statistics::accumulate(samples.begin(), samples.end(),
+								  gaml::statistics::moments(height_of),
+								  gaml::statistics::moments(square_of),
+								  gaml::statistics::frequencies<std::string>(label_of));
+
+  std::cout << heights.count() << " samples." << std::endl
+	    << "height   : average = " << heights.average() << ", variance = " << heights.variance() << std::endl
+	    << "height^2 : average = " << squares.average() << std::endl;
+  for(auto& kv : labels.frequencies())
+    std::cout << "  " << kv.first << " : " << kv.second << std::endl;
+  std::cout << "label entropy : " << labels.entropy() << " bits." << std::endl;
+
+  // gaml::average and gaml::variance rely on the same accumulators.
+  std::cout << "gaml::average  = " << gaml::average (samples.begin(), samples.end(), height_of) << std::endl
+	    << "gaml::variance = " << gaml::variance(samples.begin(), samples.end(), height_of) << std::endl;
+
+  // The same pass, split among 4 threads. The results only differ by
+  // rounding errors.
+  auto [par_heights, par_labels] = gaml::statistics::accumulate(4, samples.begin(), samples.end(),
+								 gaml::statistics::moments(height_of),
+								 gaml::statistics::frequencies<std::string>(label_of));
+  std::cout << "With 4 threads : " << par_heights.count() << " samples, "
+	    << "average = " << par_heights.average() << ", variance = " << par_heights.variance()
+	    << ", label entropy = " << par_labels.entropy() << " bits." << std::endl;
+
+  return 0;
+}
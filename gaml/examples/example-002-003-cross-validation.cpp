@@ -44,6 +44,12 @@ int main(int argc, char* argv[]) {
   auto chunk_evaluator         = gaml::risk::cross_validation(gaml::loss::Quadratic<double>(), gaml::partition::chunk(30),       verbosity);
   auto kfold_evaluator         = gaml::risk::cross_validation(gaml::loss::Quadratic<double>(), gaml::partition::kfold(6),        verbosity);
 
+  // The folds are independent, so they can be processed by several
+  // threads (4 here). The learner is then called concurrently, which
+  // is fine for our silly one since it has no state. The result is
+  // the same as with a single thread.
+  auto parallel_kfold_evaluator = gaml::risk::cross_validation(gaml::loss::Quadratic<double>(), gaml::partition::kfold(6), verbosity, 4);
+
   // Let us now set up our learning algorithm....
   silly::Learner learning_algorithm;
 
@@ -51,11 +57,13 @@ int main(int argc, char* argv[]) {
   double l1o_risk   = leave_one_out_evaluator(learning_algorithm, basis.begin(), basis.end(), silly::input_of_data, silly::output_of_data);
   double chunk_risk = chunk_evaluator        (learning_algorithm, basis.begin(), basis.end(), silly::input_of_data, silly::output_of_data);
   double kfold_risk = kfold_evaluator        (learning_algorithm, basis.begin(), basis.end(), silly::input_of_data, silly::output_of_data);
+  double pkfold_risk = parallel_kfold_evaluator(learning_algorithm, basis.begin(), basis.end(), silly::input_of_data, silly::output_of_data);
   
   std::cout << std::endl 
 	    << "Estimation of the real risk (leave one out): "  << l1o_risk   << std::endl
 	    << "Estimation of the real risk         (chunk): "  << chunk_risk << std::endl
-	    << "Estimation of the real risk        (k-fold): "  << kfold_risk << std::endl;
+	    << "Estimation of the real risk        (k-fold): "  << kfold_risk << std::endl
+	    << "Estimation of the real risk (k-fold, 4 threads): "  << pkfold_risk << std::endl;
 
   return EXIT_SUCCESS;
 }
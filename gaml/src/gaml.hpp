@@ -27,6 +27,7 @@
 
 #include <gamlAlgorithms.hpp>
 #include <gamlBag.hpp>
+#include <gamlBatch.hpp>
 #include <gamlBootstrap.hpp>
 #include <gamlCache.hpp>
 #include <gamlConfusion.hpp>
@@ -37,13 +38,16 @@
 #include <gamlGnuplot.hpp>
 #include <gamlLoss.hpp>
 #include <gamlMap.hpp>
+#include <gamlMaterialize.hpp>
 #include <gamlMerge.hpp>
 #include <gamlMultiClass.hpp>
 #include <gamlMultiDim.hpp>
 #include <gamlPartition.hpp>
 #include <gamlProjection.hpp>
+#include <gamlReseed.hpp>
 #include <gamlScore.hpp>
 #include <gamlSearch.hpp>
+#include <gamlSharedCache.hpp>
 #include <gamlSpan.hpp>
 #include <gamlSplit.hpp>
 #include <gamlVariableSelection.hpp>
@@ -52,6 +56,9 @@
 #include <gamlStreamer.hpp>
 #include <gamlTabular.hpp>
 #include <gamlIndexedDataset.hpp>
+#include <gamlMapped.hpp>
+#include <gamlMappedDataset.hpp>
+#include <gamlColumnar.hpp>
 #include <gamlWrapper.hpp>
 #include <gamlZip.hpp>
 
@@ -65,6 +72,9 @@
  * @example example-001-005-tree.cpp
  * @example example-001-006-score.cpp
  * @example example-001-007-score.cpp
+ * @example example-001-008-shared-cache.cpp
+ * @example example-001-009-columnar.cpp
+ * @example example-001-010-statistics.cpp
  * @example example-002-001-confusion.cpp
  * @example example-002-002-roc.cpp
  * @example example-002-003-cross-validation.cpp
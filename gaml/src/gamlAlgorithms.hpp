@@ -43,10 +43,18 @@
 #include <gamlMerge.hpp>
 #include <gamlPartition.hpp>
 #include <gamlMap.hpp>
+#include <gamlBatch.hpp>
+#include <gamlReseed.hpp>
 #include <iostream>
 #include <iomanip>
 #include <random>
 #include <type_traits>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <optional>
+#include <cstddef>
 
 namespace gaml {
 
@@ -66,6 +74,16 @@ namespace gaml {
       Predictor(const Predictor& other);
       Predictor& operator=(const Predictor& other);
       output_type operator()(const input_type& x) const;
+
+      /**
+       * This is optional. It writes the predictions of the inputs in
+       * [begin, end) into out, as the operator() would do one input
+       * at a time. Predictors which can share some computation
+       * between inputs provide it, gaml::predict_batch falls back to
+       * operator() otherwise.
+       */
+      template<typename InputIterator, typename OutputIterator>
+      void predict_batch(const InputIterator& begin, const InputIterator& end, OutputIterator out) const;
     };
 
     /**
@@ -120,6 +138,87 @@ namespace gaml {
 
   namespace risk {
 
+    namespace internal {
+
+      template<typename Predictor, typename DataIterator,
+	       typename InputOf, typename OutputOf, typename Loss>
+      double sum_of_losses(const Predictor& predictor,
+			   const DataIterator& begin, const DataIterator& end,
+			   const InputOf& inputOf, const OutputOf& outputOf,
+			   const Loss& loss, unsigned int& nb,
+			   std::false_type) {
+	double sum = 0;
+	nb = 0;
+	for(DataIterator it = begin; it != end; ++it, ++nb) {
+	  const auto& data = *it;
+	  sum += loss(predictor(inputOf(data)),
+		      outputOf(data));
+	}
+	return sum;
+      }
+
+      // The data is processed by batches of gaml::batch_size
+      // samples, whose predictions are computed at once. Each sample
+      // is dereferenced once (this may parse it from a file): its
+      // input and its output are copied into the batch.
+      template<typename Predictor, typename DataIterator,
+	       typename InputOf, typename OutputOf, typename Loss>
+      double sum_of_losses(const Predictor& predictor,
+			   const DataIterator& begin, const DataIterator& end,
+			   const InputOf& inputOf, const OutputOf& outputOf,
+			   const Loss& loss, unsigned int& nb,
+			   std::true_type) {
+	typedef typename std::decay<decltype(inputOf(*begin))>::type            input_type;
+	typedef typename std::decay<decltype(outputOf(*begin))>::type           target_type;
+	typedef typename std::decay<decltype(predictor(inputOf(*begin)))>::type output_type;
+	std::vector<input_type>  inputs;
+	std::vector<target_type> targets;
+	std::vector<output_type> predictions;
+	inputs.reserve(gaml::batch_size);
+	targets.reserve(gaml::batch_size);
+	predictions.reserve(gaml::batch_size);
+
+	double sum = 0;
+	nb = 0;
+	DataIterator it = begin;
+	while(it != end) {
+	  inputs.clear();
+	  targets.clear();
+	  for(unsigned int size = 0; it != end && size < gaml::batch_size; ++size, ++it, ++nb) {
+	    const auto& data = *it;
+	    inputs.push_back(inputOf(data));
+	    targets.push_back(outputOf(data));
+	  }
+
+	  predictions.clear();
+	  gaml::predict_batch(predictor, inputs.cbegin(), inputs.cend(), std::back_inserter(predictions));
+	  for(std::size_t i = 0; i < predictions.size(); ++i)
+	    sum += loss(predictions[i], targets[i]);
+	}
+	return sum;
+      }
+
+      /**
+       * The sum of the losses over [begin, end). The predictions are
+       * computed by batches if the predictor provides predict_batch.
+       * @param nb Set to the number of samples, counted in the same
+       * pass (the iterators may not be random access ones).
+       */
+      template<typename Predictor, typename DataIterator,
+	       typename InputOf, typename OutputOf, typename Loss>
+      double sum_of_losses(const Predictor& predictor,
+			   const DataIterator& begin, const DataIterator& end,
+			   const InputOf& inputOf, const OutputOf& outputOf,
+			   const Loss& loss, unsigned int& nb) {
+	typedef typename std::decay<decltype(inputOf(*begin))>::type            input_type;
+	typedef typename std::decay<decltype(predictor(inputOf(*begin)))>::type output_type;
+	typedef typename has_predict_batch<Predictor,
+					   typename std::vector<input_type>::const_iterator,
+					   std::back_insert_iterator<std::vector<output_type>>>::type batch_type;
+	return sum_of_losses(predictor, begin, end, inputOf, outputOf, loss, nb, batch_type());
+      }
+    }
+
     template<typename Predictor,typename DataIterator,
 	     typename InputOf, typename OutputOf,
 	     typename Loss, typename AccumIterator>
@@ -148,14 +247,7 @@ namespace gaml {
       double operator()(const Predictor& predictor,const DataIterator& begin, const DataIterator& end,
 			const InputOf& inputOf, const OutputOf& outputOf) const {
 	unsigned int nb = 0;
-	double sum = 0;
-	for(DataIterator it = begin; it != end; ++it) {
-	  auto& data = *it;
-	  sum += loss(predictor(inputOf(data)),
-		      outputOf(data));
-	  ++nb;
-	}
-
+	double sum = internal::sum_of_losses(predictor, begin, end, inputOf, outputOf, loss, nb);
 	return sum/nb;
       }
     };
@@ -164,6 +256,13 @@ namespace gaml {
     Empirical<LOSS> empirical(const LOSS& loss) {return Empirical<LOSS>(loss);}
     
 
+    /**
+     * This estimates the risk of a learner by training and testing it
+     * on each fold of a partition. The folds are independent, so they
+     * can be processed by several threads at once. The risk does not
+     * depend on the number of threads, and the verbose output is
+     * written in the order of the folds.
+     */
     template<typename LOSS, typename PARTITION>
     class CrossValidation {
     private:
@@ -171,61 +270,109 @@ namespace gaml {
       LOSS loss;
       PARTITION partition;
       bool verbose;
+      unsigned int nb_threads;
 
     public:
 
 
-      CrossValidation(const LOSS& l, const PARTITION& part,bool verbosity) 
-	: loss(l), partition(part), verbose(verbosity) {}
-      CrossValidation(const CrossValidation& other) : loss(other.loss), partition(other.partition), verbose(other.verbose) {}
+      /**
+       * @param threads The number of folds processed at once. Each
+       * fold is learnt by its own copy of the learner, reseeded from
+       * the rank of the fold (see gaml::bag::reseed), so that the
+       * risk does not depend on the number of threads. When it is
+       * greater than 1, the loss is used concurrently from several
+       * threads.
+       */
+      CrossValidation(const LOSS& l, const PARTITION& part,bool verbosity, unsigned int threads = 1) 
+	: loss(l), partition(part), verbose(verbosity), nb_threads(threads) {}
+      CrossValidation(const CrossValidation& other) : loss(other.loss), partition(other.partition), verbose(other.verbose), nb_threads(other.nb_threads) {}
 
       template<typename Learner, typename DataIterator, typename InputOf, typename OutputOf> 
       double operator()(const Learner& learner,const DataIterator& begin, const DataIterator& end,
 			const InputOf& inputOf, const OutputOf& outputOf) const {
 
 	auto built_partition = partition.build(begin,end);
-	double sum = 0;
+	unsigned int nb_folds = built_partition.size();
+	std::vector<double> risks(nb_folds, 0);
 	
 	if(verbose)
-	  std::cout << "Splitting the database into " << built_partition.size() << " sets." << std::endl;
-	for(unsigned int i = 0; i < built_partition.size(); ++i) {
-	  
-	  auto begin  = built_partition.begin(i);
-	  auto end    = built_partition.end(i);
-	  auto _begin = built_partition.complement_begin(i);
-	  auto _end   = built_partition.complement_end(i);
-	  
-	  if(verbose)
-	    std::cout << std::setw(6) << i+1 << '/' << built_partition.size() 
-		      << " : learning...\r" << std::flush;
-	  
-	  auto predictor = learner(_begin, _end, inputOf, outputOf);
-	  
-
-	  double risk=0;
-	  for(DataIterator it = begin; it != end; ++it) {
-	    auto& data = *it;
-	    risk += loss(predictor(inputOf(data)),
-			 outputOf(data));
-	  }
-
-	  if(verbose) {
-	    auto size = std::distance(begin,end);
-	    std::cout << std::setw(6) << i+1 << '/' << built_partition.size() 
-		      << " : risk = " << risk / size << " (" 
-		      << size << "-sized test set)" << std::endl;
+	  std::cout << "Splitting the database into " << nb_folds << " sets." << std::endl;
+
+	auto fold_risk = [&](unsigned int i) -> double {
+	  Learner fold_learner = learner;
+	  std::seed_seq seq {i};
+	  bag::reseed(fold_learner, seq);
+	  auto predictor = fold_learner(built_partition.complement_begin(i), built_partition.complement_end(i), inputOf, outputOf);
+	  unsigned int nb = 0;
+	  return internal::sum_of_losses(predictor, built_partition.begin(i), built_partition.end(i), inputOf, outputOf, loss, nb);
+	};
+
+	auto report = [&](unsigned int i) {
+	  auto size = std::distance(built_partition.begin(i), built_partition.end(i));
+	  std::cout << std::setw(6) << i+1 << '/' << nb_folds
+		    << " : risk = " << risks[i] / size << " (" 
+		    << size << "-sized test set)" << std::endl;
+	};
+
+	unsigned int nb_workers = std::min(nb_threads, nb_folds);
+	if(nb_workers <= 1) {
+	  for(unsigned int i = 0; i < nb_folds; ++i) {
+	    if(verbose)
+	      std::cout << std::setw(6) << i+1 << '/' << nb_folds
+			<< " : learning...\r" << std::flush;
+	    risks[i] = fold_risk(i);
+	    if(verbose)
+	      report(i);
 	  }
-	  
-	  sum += risk;
+	}
+	else {
+	  // Each worker takes the next fold to be processed. A fold is
+	  // reported once all the previous ones have been reported.
+	  std::atomic<unsigned int> next_fold(0);
+	  std::mutex report_mutex;
+	  std::vector<bool> done(nb_folds, false);
+	  unsigned int next_report = 0;
+	  std::vector<std::exception_ptr> errors(nb_folds);
+
+	  auto work = [&]() {
+	    for(unsigned int i = next_fold++; i < nb_folds; i = next_fold++) {
+	      try {
+		risks[i] = fold_risk(i);
+	      }
+	      catch(...) {
+		errors[i] = std::current_exception();
+	      }
+	      std::lock_guard<std::mutex> lock(report_mutex);
+	      done[i] = true;
+	      for(; next_report < nb_folds && done[next_report]; ++next_report)
+		if(verbose && !errors[next_report])
+		  report(next_report);
+	    }
+	  };
+
+	  std::vector<std::thread> workers;
+	  for(unsigned int w = 0; w < nb_workers; ++w)
+	    workers.emplace_back(work);
+	  for(auto& worker : workers)
+	    worker.join();
+
+	  for(auto& error : errors)
+	    if(error)
+	      std::rethrow_exception(error);
 	}
 	
+	// The sum is done in the order of the folds, whatever the
+	// order in which they have been processed.
+	double sum = 0;
+	for(auto risk : risks)
+	  sum += risk;
 	return (double)(sum/(double)(built_partition.data_size()));
       }
     };
     
     template<typename LOSS, typename PARTITION>
-    CrossValidation<LOSS,PARTITION> cross_validation(const LOSS& l, const PARTITION& part,bool verbosity) {
-      return CrossValidation<LOSS,PARTITION>(l,part,verbosity);
+    CrossValidation<LOSS,PARTITION> cross_validation(const LOSS& l, const PARTITION& part,bool verbosity, unsigned int nb_threads = 1) {
+      return CrossValidation<LOSS,PARTITION>(l,part,verbosity,nb_threads);
     }
 
   }
@@ -264,25 +411,234 @@ namespace gaml {
     bool operator!=(const integer& i) const {return j != i.j;}
   };
 
+  namespace by_default {
+    template<typename VALUE>
+    struct LesserThan {
+      bool operator()(const VALUE& v1, const VALUE& v2) const {
+	return v1 < v2;
+      }
+    };
+  }
+
+  /**
+   * These are accumulators, that compute statistics of a collection
+   * in a single pass. Each one is built from the function giving the
+   * value of an element, it is fed with the elements by
+   * gaml::statistics::accumulate, several accumulators being fed in
+   * the same pass. The accumulators of distinct chunks of a
+   * collection can be merged.
+   */
+  namespace statistics {
+
+    /**
+     * This computes the number of values, their average and their
+     * variance (Welford's update, Chan's merge).
+     */
+    template<typename ValueOf>
+    class Moments {
+    private:
+      ValueOf value_of;
+      double n;
+      double mean;
+      double M2;
+
+    public:
+      Moments(const ValueOf& value_of) : value_of(value_of), n(0), mean(0), M2(0) {}
+      Moments(const Moments&) = default;
+
+      template<typename Data>
+      void operator()(const Data& data) {
+	double x =  (double)(value_of(data));
+	double delta = x - mean;
+	mean = mean + delta/(++n);
+	M2 = M2 + delta*(x - mean);
+      }
+
+      void merge(const Moments& other) {
+	if(other.n == 0)
+	  return;
+	double total = n + other.n;
+	double delta = other.mean - mean;
+	mean = mean + delta*other.n/total;
+	M2   = M2 + other.M2 + delta*delta*n*other.n/total;
+	n    = total;
+      }
+
+      double count() const {return n;}
+
+      double average() const {
+	if(n == 0)
+	  throw std::runtime_error("Average called on an empty collection");
+	return mean;
+      }
+
+      double variance() const {
+	if (n < 2) return 0;
+	return M2/(n - 1);
+      }
+    };
+
+    template<typename ValueOf>
+    Moments<std::decay_t<ValueOf>> moments(const ValueOf& value_of) {
+      return Moments<std::decay_t<ValueOf>>(value_of);
+    }
+
+    /**
+     * This counts the occurrences of each value. Small non negative
+     * integral values (labels) are counted in an array, the other
+     * ones in a map.
+     */
+    template<typename VALUE, typename ValueOf, typename COMP = by_default::LesserThan<VALUE>>
+    class Frequencies {
+    private:
+      static constexpr std::size_t dense_size = 1024;
+      using is_dense = std::integral_constant<bool, std::is_integral_v<VALUE> && !std::is_same_v<std::remove_cv_t<VALUE>, bool>>;
+
+      ValueOf                     value_of;
+      std::vector<double>         dense;
+      std::map<VALUE,double,COMP> sparse;
+      double                      n;
+
+      void count(const VALUE& value, std::true_type) {
+	if(value >= 0 && (std::size_t)value < dense_size) {
+	  if(dense.size() <= (std::size_t)value)
+	    dense.resize((std::size_t)value + 1, 0);
+	  ++dense[(std::size_t)value];
+	}
+	else
+	  ++sparse[value];
+      }
+
+      void count(const VALUE& value, std::false_type) {
+	++sparse[value];
+      }
+
+      void add_dense(std::map<VALUE,double,COMP>& res, std::true_type) const {
+	for(std::size_t i = 0; i < dense.size(); ++i)
+	  if(dense[i] != 0)
+	    res[(VALUE)i] += dense[i];
+      }
+
+      void add_dense(std::map<VALUE,double,COMP>&, std::false_type) const {}
+
+    public:
+      Frequencies(const ValueOf& value_of) : value_of(value_of), dense(), sparse(), n(0) {}
+      Frequencies(const Frequencies&) = default;
+
+      template<typename Data>
+      void operator()(const Data& data) {
+	count(value_of(data), is_dense());
+	++n;
+      }
+
+      void merge(const Frequencies& other) {
+	if(dense.size() < other.dense.size())
+	  dense.resize(other.dense.size(), 0);
+	for(std::size_t i = 0; i < other.dense.size(); ++i)
+	  dense[i] += other.dense[i];
+	for(auto& kv : other.sparse)
+	  sparse[kv.first] += kv.second;
+	n += other.n;
+      }
+
+      double count() const {return n;}
+
+      /**
+       * @returns The map of (value,frequency) pairs.
+       */
+      std::map<VALUE,double,COMP> frequencies() const {
+	if(n == 0)
+	  throw std::runtime_error("Frequencies called on an empty collection");
+	std::map<VALUE,double,COMP> res = sparse;
+	add_dense(res, is_dense());
+	for(auto& kv : res) kv.second /= n;
+	return res;
+      }
+
+      /**
+       * @returns The entropy (in bits) of the values.
+       */
+      double entropy() const {
+	double H = 0;
+	for(auto& kv : frequencies()) {
+	  double p = kv.second;
+	  H -= p*std::log2(p);
+	}
+	return H;
+      }
+    };
+
+    template<typename VALUE, typename COMP = by_default::LesserThan<VALUE>, typename ValueOf>
+    Frequencies<VALUE,std::decay_t<ValueOf>,COMP> frequencies(const ValueOf& value_of) {
+      return Frequencies<VALUE,std::decay_t<ValueOf>,COMP>(value_of);
+    }
+
+    namespace internal {
+      template<typename Tuple, std::size_t... I>
+      void merge(Tuple& res, const Tuple& other, std::index_sequence<I...>) {
+	(std::get<I>(res).merge(std::get<I>(other)), ...);
+      }
+    }
+
+    /**
+     * This feeds copies of the accumulators with the elements of
+     * [begin, end), in a single pass.
+     * @returns The tuple of the fed accumulators.
+     */
+    template<typename DataIterator, typename... Accumulators>
+    std::tuple<Accumulators...> accumulate(const DataIterator& begin, const DataIterator& end, const Accumulators&... accumulators) {
+      std::tuple<Accumulators...> res(accumulators...);
+      for(auto it = begin; it != end; ++it)
+	std::apply([&it](auto&... acc) {(acc(*it), ...);}, res);
+      return res;
+    }
+
+    /**
+     * This is the same as the previous one, for random access
+     * iterators. The collection is split in nb_threads chunks, that
+     * are processed in parallel. The accumulators of the chunks are
+     * then merged, in the order of the chunks.
+     */
+    template<typename DataIterator, typename... Accumulators>
+    std::tuple<Accumulators...> accumulate(unsigned int nb_threads, const DataIterator& begin, const DataIterator& end, const Accumulators&... accumulators) {
+      std::size_t size = std::distance(begin, end);
+      unsigned int nb_chunks = (unsigned int)(std::min<std::size_t>(nb_threads, size));
+      if(nb_chunks <= 1)
+	return statistics::accumulate(begin, end, accumulators...);
+
+      std::vector<std::optional<std::tuple<Accumulators...>>> results(nb_chunks);
+      std::vector<std::exception_ptr> errors(nb_chunks);
+      std::vector<std::thread> workers;
+      for(unsigned int c = 0; c < nb_chunks; ++c)
+	workers.emplace_back([&, c]() {
+	    try {
+	      results[c] = statistics::accumulate(begin + size*c/nb_chunks, begin + size*(c+1)/nb_chunks, accumulators...);
+	    }
+	    catch(...) {
+	      errors[c] = std::current_exception();
+	    }
+	  });
+      for(auto& worker : workers)
+	worker.join();
+      for(auto& error : errors)
+	if(error)
+	  std::rethrow_exception(error);
+
+      std::tuple<Accumulators...> res = *(results[0]);
+      for(unsigned int c = 1; c < nb_chunks; ++c)
+	internal::merge(res, *(results[c]), std::index_sequence_for<Accumulators...>());
+      return res;
+    }
+  }
+
   namespace functor {
     class average {
     public:
       typedef double output_type;
       template<typename DataIterator,typename ValueOf> 
       double operator()(const DataIterator& begin, const DataIterator& end, const ValueOf& value_of) const {
-	if(begin == end)
-	  throw std::runtime_error("Average called on an empty collection");
-
-	// std::accumulate does not work... Is there a problem in map iterator dfinition ?
-    
-	// auto values = gaml::map(begin,end,value_of);
-	// return (Y)(std::accumulate(values.begin(),values.end(),0)/(double)nb);
-
-	// The version without std::accumulate does not require nb.
-	double sum = 0;
-	unsigned int nb = 0;
-	for(auto it = begin; it != end; ++it, ++nb) sum += (double)(value_of(*it));
-	return sum/(double)nb;
+	auto [moments] = statistics::accumulate(begin, end, statistics::moments(value_of));
+	return moments.average();
       }
     };
   }
@@ -303,17 +659,8 @@ namespace gaml {
       typedef double output_type;
       template<typename DataIterator,typename ValueOf> 
       double operator()(const DataIterator& begin, const DataIterator& end, const ValueOf& value_of) const {
-	double n    = 0;
-	double mean = 0;
-	double M2   = 0;
-	for(auto it = begin; it != end; ++it) {
-	  double x =  (double)(value_of(*it));
-	  double delta = x - mean;
-	  mean = mean + delta/(++n);
-	  M2 = M2 + delta*(x - mean);
-	}
-	if (n < 2) return 0;
-	return M2/(n - 1);
+	auto [moments] = statistics::accumulate(begin, end, statistics::moments(value_of));
+	return moments.variance();
       }
     };
   }
@@ -328,15 +675,6 @@ namespace gaml {
     return var(begin,end,value_of);
   }
 
-  namespace by_default {
-    template<typename VALUE>
-    struct LesserThan {
-      bool operator()(const VALUE& v1, const VALUE& v2) const {
-	return v1 < v2;
-      }
-    };
-  }
-
   namespace functor {
     template<typename VALUE, typename COMP = by_default::LesserThan<VALUE> > 
     class frequencies {
@@ -347,19 +685,8 @@ namespace gaml {
 	if(begin == end)
 	  throw std::runtime_error("Frequencies called on an empty collection");
 
-	std::map<VALUE,double,COMP> frequencies;
-	for(auto it = begin; it != end; ++it) {
-	  auto value = value_of(*it);
-	  auto mapit = frequencies.find(value);
-	  if(mapit == frequencies.end())
-	    frequencies[value] = 1;
-	  else
-	    ++(mapit->second);
-	}
-
-	double size = (double)(std::distance(begin,end));
-	for(auto& kv : frequencies) kv.second /= size;
-	return frequencies;
+	auto [freq] = statistics::accumulate(begin, end, statistics::frequencies<VALUE,COMP>(value_of));
+	return freq.frequencies();
       }
     };
   }
@@ -447,12 +774,9 @@ namespace gaml {
    */
   template<typename Class, typename DataIterator, typename ClassComp = by_default::LesserThan<Class>, typename ClassOf> 
   double classification_entropy(const DataIterator& begin, const DataIterator& end, const ClassOf& class_of) {
-    auto freq = gaml::frequencies<Class,ClassComp>(begin,end,class_of);
-    double H = 0;
-    for(auto& kv : freq) {
-      double p = kv.second;
-      H -= p*std::log2(p);
-    }
-    return H;
+    if(begin == end)
+      throw std::runtime_error("Frequencies called on an empty collection");
+    auto [freq] = statistics::accumulate(begin, end, statistics::frequencies<Class,ClassComp>(class_of));
+    return freq.entropy();
   }
 }
@@ -29,7 +29,19 @@
 #include <iomanip>
 #include <vector>
 #include <iterator>
+#include <numeric>
+#include <random>
+#include <memory>
+#include <optional>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <type_traits>
 #include <gamlBootstrap.hpp>
+#include <gamlBatch.hpp>
+#include <gamlReseed.hpp>
 
 namespace gaml {
   namespace bag {
@@ -73,11 +85,47 @@ namespace gaml {
 	auto prediction_of = [&x](const ElementaryPredictor& p) -> elementary_output_type {return p(x);};
 	return merge(predictors.begin(),predictors.end(),prediction_of);
       }
+
+      /**
+       * Each elementary predictor processes a whole batch of inputs
+       * before the next one is used, so that it stays in the
+       * cache. The predictions are merged afterwards.
+       */
+      template<typename InputIterator, typename OutputIterator>
+      void predict_batch(const InputIterator& begin, const InputIterator& end, OutputIterator out) const {
+	std::vector<std::vector<elementary_output_type>> predictions(predictors.size());
+	std::vector<unsigned int> ranks(predictors.size());
+	std::iota(ranks.begin(), ranks.end(), 0);
+
+	InputIterator batch_begin = begin;
+	while(batch_begin != end) {
+	  unsigned int nb;
+	  InputIterator batch_end = gaml::batch_end(batch_begin, end, nb);
+
+	  for(unsigned int k = 0; k < predictors.size(); ++k) {
+	    predictions[k].clear();
+	    gaml::predict_batch(predictors[k], batch_begin, batch_end, std::back_inserter(predictions[k]));
+	  }
+
+	  for(unsigned int i = 0; i < nb; ++i) {
+	    auto prediction_of = [&predictions, i](unsigned int k) -> elementary_output_type {return predictions[k][i];};
+	    *(out++) = merge(ranks.begin(), ranks.end(), prediction_of);
+	  }
+	  batch_begin = batch_end;
+	}
+      }
     };
 
     /**
      * This learner produces a collection of predictors by learning
      * each one from a randomization of the input data set.
+     *
+     * When it is built with a seed, the predictors are learnt in
+     * parallel by nb_threads workers. The elementary learner and the
+     * randomizer are then copied for each predictor, and the copies
+     * are reseeded (see gaml::bag::reseed) from the seed and the rank
+     * of the predictor. The result is thus reproducible, whatever the
+     * number of threads.
      */
     template<typename MergeOutput,
 	     typename BasisRandomizer,
@@ -92,6 +140,9 @@ namespace gaml {
       BasisRandomizer randomizer;
       unsigned int nb_predictors;
       bool verbosity;
+      bool seeded;
+      unsigned int nb_threads;
+      std::uint64_t seed;
       
       Learner(const ElementaryLearner& l, 
 	      const MergeOutput& output_merger,
@@ -102,13 +153,34 @@ namespace gaml {
 	  merger(output_merger),
 	  randomizer(dataset_randomizer),
 	  nb_predictors(size),
-	  verbosity(is_verbose){}
+	  verbosity(is_verbose),
+	  seeded(false),
+	  nb_threads(1),
+	  seed(0) {}
+      Learner(const ElementaryLearner& l, 
+	      const MergeOutput& output_merger,
+	      const BasisRandomizer& dataset_randomizer,
+	      unsigned int size,
+	      bool is_verbose,
+	      unsigned int threads,
+	      std::uint64_t master_seed) 
+	: learner(l), 
+	  merger(output_merger),
+	  randomizer(dataset_randomizer),
+	  nb_predictors(size),
+	  verbosity(is_verbose),
+	  seeded(true),
+	  nb_threads(threads),
+	  seed(master_seed) {}
       Learner(const Learner& other) 
 	: learner(other.learner), 
 	  merger(other.merger),
 	  randomizer(other.randomizer),
 	  nb_predictors(other.nb_predictors),
-	  verbosity(other.verbosity) {}
+	  verbosity(other.verbosity),
+	  seeded(other.seeded),
+	  nb_threads(other.nb_threads),
+	  seed(other.seed) {}
       Learner& operator=(const Learner& other) {
 	if(this != &other) {
 	  learner       = other.learner;
@@ -116,6 +188,9 @@ namespace gaml {
 	  randomizer    = other.randomizer;
 	  nb_predictors = other.nb_predictors;
 	  verbosity     = other.verbosity;
+	  seeded        = other.seeded;
+	  nb_threads    = other.nb_threads;
+	  seed          = other.seed;
 	}
 	return *this;
       }
@@ -123,6 +198,9 @@ namespace gaml {
       template<typename DataIterator, typename InputOf, typename OutputOf> 
       predictor_type operator()(const DataIterator& begin, const DataIterator& end,
 				const InputOf& input_of, const OutputOf& output_of) const {
+	if(seeded)
+	  return parallel(begin, end, input_of, output_of);
+
 	predictor_type predictor;
 	auto out = std::back_inserter(predictor.predictors);
 
@@ -140,6 +218,69 @@ namespace gaml {
 	  std::cout << std::endl << std::endl;
 	return predictor;
       }
+
+    private:
+
+      template<typename DataIterator, typename InputOf, typename OutputOf> 
+      predictor_type parallel(const DataIterator& begin, const DataIterator& end,
+			      const InputOf& input_of, const OutputOf& output_of) const {
+	std::vector<std::optional<typename ElementaryLearner::predictor_type>> learnt(nb_predictors);
+	std::vector<std::exception_ptr> errors(nb_predictors);
+	std::atomic<unsigned int> next(0);
+	std::mutex verbosity_mutex;
+	unsigned int nb_done = 0;
+
+	auto work = [&]() {
+	  for(unsigned int i = next++; i < nb_predictors; i = next++) {
+	    try {
+	      // The streams of predictor i only depend on the seed and on i.
+	      ElementaryLearner l = learner;
+	      BasisRandomizer   r = randomizer;
+	      std::seed_seq learner_seq    {(std::uint32_t)seed, (std::uint32_t)(seed >> 32), i, 0u};
+	      std::seed_seq randomizer_seq {(std::uint32_t)seed, (std::uint32_t)(seed >> 32), i, 1u};
+	      bag::reseed(l, learner_seq);
+	      bag::reseed(r, randomizer_seq);
+
+	      auto randomized_basis = r(begin,end);
+	      learnt[i].emplace(l(randomized_basis.begin(),
+				  randomized_basis.end(),
+				  input_of,output_of));
+	    }
+	    catch(...) {
+	      errors[i] = std::current_exception();
+	    }
+	    if(verbosity) {
+	      std::lock_guard<std::mutex> lock(verbosity_mutex);
+	      std::cout << "Learning " << std::setw(3) << ++nb_done << '/' << nb_predictors << "...                \r" << std::flush;
+	    }
+	  }
+	};
+
+	if(verbosity)
+	  std::cout << std::endl;
+	unsigned int nb_workers = std::max(1u, std::min(nb_threads, nb_predictors));
+	if(nb_workers == 1)
+	  work();
+	else {
+	  std::vector<std::thread> workers;
+	  for(unsigned int w = 0; w < nb_workers; ++w)
+	    workers.emplace_back(work);
+	  for(auto& worker : workers)
+	    worker.join();
+	}
+	if(verbosity)
+	  std::cout << std::endl << std::endl;
+
+	for(auto& error : errors)
+	  if(error)
+	    std::rethrow_exception(error);
+
+	predictor_type predictor;
+	predictor.predictors.reserve(nb_predictors);
+	for(auto& p : learnt)
+	  predictor.predictors.push_back(std::move(*p));
+	return predictor;
+      }
     };
 
     
@@ -153,6 +294,24 @@ namespace gaml {
 								   bool is_verbose) {
       return Learner<MergeOutput,BasisRandomizer,ElementaryLearner>(l,output_merger,dataset_randomizer,size,is_verbose);
     }
+
+    /**
+     * This builds a learner which learns the predictors in parallel.
+     * @param nb_threads The number of workers.
+     * @param seed The seed from which the random generators of each predictor are reseeded.
+     */
+    template<typename MergeOutput,
+	     typename BasisRandomizer,
+	     typename ElementaryLearner>
+    Learner<MergeOutput,BasisRandomizer,ElementaryLearner> learner(const ElementaryLearner& l, 
+								   const MergeOutput& output_merger,
+								   const BasisRandomizer& dataset_randomizer,
+								   unsigned int size,
+								   bool is_verbose,
+								   unsigned int nb_threads,
+								   std::uint64_t seed) {
+      return Learner<MergeOutput,BasisRandomizer,ElementaryLearner>(l,output_merger,dataset_randomizer,size,is_verbose,nb_threads,seed);
+    }
     
     namespace functor {
 
@@ -177,13 +336,23 @@ namespace gaml {
       class Bootstrap {
       private:
 	unsigned int size;
-	RANDOM_DEVICE& rd;
+	RANDOM_DEVICE* rd;
+	std::shared_ptr<RANDOM_DEVICE> own_rd;
       public:
 	Bootstrap(unsigned int bootstrap_set_size, RANDOM_DEVICE& rd)
-	  : size(bootstrap_set_size), rd(rd) {}
+	  : size(bootstrap_set_size), rd(&rd), own_rd() {}
 	template<typename DataIterator> 
 	auto operator()(const DataIterator& begin, const DataIterator& end) const {
-	  return gaml::bootstrap(begin,end,size, rd);
+	  return gaml::bootstrap(begin,end,size, *rd);
+	}
+
+	/**
+	 * The randomizer stops using the shared generator, and draws
+	 * from its own one, seeded from seq.
+	 */
+	void reseed(std::seed_seq& seq) {
+	  own_rd = std::make_shared<RANDOM_DEVICE>(seq);
+	  rd     = own_rd.get();
 	}
       };
 
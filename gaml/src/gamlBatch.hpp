@@ -0,0 +1,150 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2012,  Supelec
+ *
+ *   Author : Hervé Frezza-Buet, Frédéric Pennerath 
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : herve.frezza-buet@supelec.fr, frederic.pennerath@supelec.fr
+ *
+ */
+
+#include <iterator>
+#include <utility>
+#include <type_traits>
+
+namespace gaml {
+
+  /**
+   * The number of samples which are predicted at once when a
+   * collection is split into batches (see
+   * gaml::risk::Empirical). Batches of that size keep the inputs and
+   * the predictions in the cache.
+   */
+  constexpr unsigned int batch_size = 1024;
+
+  /**
+   * @return the end of the batch starting at begin, i.e. the
+   * iterator gaml::batch_size steps after begin, or end if it is
+   * closer.
+   * @param nb receives the number of elements in the batch.
+   */
+  template<typename Iterator>
+  Iterator batch_end(const Iterator& begin, const Iterator& end, unsigned int& nb) {
+    Iterator it = begin;
+    for(nb = 0; it != end && nb < batch_size; ++nb, ++it);
+    return it;
+  }
+
+  template<typename T> using test_predict_batch = void;
+
+  /**
+   * has_predict_batch<Predictor,InputIterator,OutputIterator>::type
+   * is std::true_type if the predictor provides a predict_batch
+   * method that can be called on such iterators (see
+   * gaml::concepts::Predictor), and std::false_type otherwise.
+   */
+  template<typename Predictor, typename InputIterator, typename OutputIterator, typename = void>
+  struct has_predict_batch : std::false_type {};
+
+  template<typename Predictor, typename InputIterator, typename OutputIterator>
+  struct has_predict_batch<Predictor, InputIterator, OutputIterator,
+			   test_predict_batch<decltype(std::declval<const Predictor&>().predict_batch(std::declval<InputIterator>(),
+												      std::declval<InputIterator>(),
+												      std::declval<OutputIterator>()))> > : std::true_type {};
+
+  namespace internal {
+    template<typename Predictor, typename InputIterator, typename OutputIterator>
+    void predict_batch(const Predictor& predictor,
+		       const InputIterator& begin, const InputIterator& end,
+		       OutputIterator out,
+		       std::true_type) {
+      predictor.predict_batch(begin, end, out);
+    }
+
+    template<typename Predictor, typename InputIterator, typename OutputIterator>
+    void predict_batch(const Predictor& predictor,
+		       const InputIterator& begin, const InputIterator& end,
+		       OutputIterator out,
+		       std::false_type) {
+      for(InputIterator it = begin; it != end; ++it)
+	*(out++) = predictor(*it);
+    }
+  }
+
+  /**
+   * This writes the predictions of all the inputs in [begin, end)
+   * into out. The predictor method predict_batch is used if it
+   * exists, otherwise the predictor is called on each input.
+   */
+  template<typename Predictor, typename InputIterator, typename OutputIterator>
+  void predict_batch(const Predictor& predictor,
+		     const InputIterator& begin, const InputIterator& end,
+		     OutputIterator out) {
+    internal::predict_batch(predictor, begin, end, out,
+			    typename has_predict_batch<Predictor, InputIterator, OutputIterator>::type());
+  }
+
+  /**
+   * This iterates over the inputs of some data, i.e. *it is
+   * input_of(*data_it). Unlike gaml::map, the input is not copied
+   * into the iterator when the data iterator returns references, so
+   * that references returned by input_of remain valid. When the data
+   * iterator returns temporaries, the input is returned by value,
+   * since a reference into the temporary would dangle.
+   */
+  template<typename DataIterator, typename InputOf>
+  class InputOfIterator {
+  private:
+
+    DataIterator it;
+    const InputOf* input_of;
+
+  public:
+
+    using input_type        = decltype(std::declval<const InputOf&>()(*std::declval<DataIterator>()));
+    using value_type        = typename std::decay<input_type>::type;
+    using reference         = typename std::conditional<std::is_lvalue_reference<decltype(*std::declval<DataIterator>())>::value,
+							input_type, value_type>::type;
+    using pointer           = value_type*;
+    using difference_type   = typename std::iterator_traits<DataIterator>::difference_type;
+    using iterator_category = std::forward_iterator_tag;
+
+    InputOfIterator() : it(), input_of(nullptr) {}
+    InputOfIterator(const DataIterator& iter, const InputOf& inputOf) : it(iter), input_of(&inputOf) {}
+    InputOfIterator(const InputOfIterator&)            = default;
+    InputOfIterator& operator=(const InputOfIterator&) = default;
+
+    InputOfIterator& operator++() {++it; return *this;}
+    InputOfIterator  operator++(int) {
+      InputOfIterator res = *this;
+      ++*this;
+      return res;
+    }
+
+    reference operator*()                         const {return (*input_of)(*it);}
+    bool      operator==(const InputOfIterator& i) const {return it == i.it;}
+    bool      operator!=(const InputOfIterator& i) const {return it != i.it;}
+  };
+
+  template<typename DataIterator, typename InputOf>
+  InputOfIterator<DataIterator, InputOf> input_of_iterator(const DataIterator& it, const InputOf& input_of) {
+    return InputOfIterator<DataIterator, InputOf>(it, input_of);
+  }
+}
@@ -30,12 +30,311 @@
 #include <iterator>
 #include <algorithm>
 #include <optional>
+#include <limits>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace gaml {
+
+  /**
+   * These are the eviction policies of gaml::Cache. A policy manages
+   * the slots of the pages in the cache (in [0, nb_pages)). It is told
+   * about the page accesses, the hits and the loads, and it chooses
+   * the slot whose page is replaced when a new page has to be
+   * loaded. The victim is only asked for when all the slots are used.
+   */
+  namespace eviction {
+
+    /**
+     * This is the historical policy of the cache. At each access, the
+     * score of every page is decayed by a factor .9, the score of the
+     * accessed page is then incremented. A loaded page has a null
+     * score, and the page with the lowest score is evicted.
+     *
+     * The decay is not applied to every page at each access. The
+     * scores are stored at the scale of the current time, which is
+     * rescaled from time to time, so that an access costs O(1). Only
+     * the choice of a victim scans the pages.
+     */
+    class Score {
+    private:
+      std::vector<double> scores;
+      double unit; // This is .9^-t.
+
+      void rescale() {
+	for(auto& s : scores) s /= unit;
+	unit = 1;
+      }
+
+    public:
+      Score() : scores(), unit(1) {}
+
+      void init(unsigned int nb_pages) {scores.assign(nb_pages, 0); unit = 1;}
+      void access() {
+	unit /= .9;
+	if(unit > 1e100)
+	  rescale();
+      }
+      void hit(unsigned int slot)  {scores[slot] += unit;}
+      void load(unsigned int slot) {scores[slot]  = 0;}
+      unsigned int victim() {
+	return std::distance(scores.begin(), std::min_element(scores.begin(), scores.end()));
+      }
+    };
+
+    /**
+     * The least recently used page is evicted. The slots are kept in
+     * a doubly linked list, from the most to the least recently used
+     * one.
+     */
+    class LRU {
+    private:
+      std::vector<unsigned int> prev;
+      std::vector<unsigned int> next;
+      unsigned int head;
+      unsigned int tail;
+      unsigned int nb;
+      static constexpr unsigned int none = std::numeric_limits<unsigned int>::max();
+
+      void unlink(unsigned int slot) {
+	if(prev[slot] != none) next[prev[slot]] = next[slot]; else head = next[slot];
+	if(next[slot] != none) prev[next[slot]] = prev[slot]; else tail = prev[slot];
+      }
+
+      void push_front(unsigned int slot) {
+	prev[slot] = none;
+	next[slot] = head;
+	if(head != none) prev[head] = slot; else tail = slot;
+	head = slot;
+      }
+
+    public:
+      LRU() : prev(), next(), head(none), tail(none), nb(0) {}
+
+      void init(unsigned int nb_pages) {
+	prev.assign(nb_pages, none);
+	next.assign(nb_pages, none);
+	head = tail = none;
+	nb = nb_pages;
+      }
+      void access() {}
+      void hit(unsigned int slot) {
+	if(slot != head) {
+	  unlink(slot);
+	  push_front(slot);
+	}
+      }
+      void load(unsigned int slot) {
+	if(prev[slot] != none || next[slot] != none || head == slot)
+	  unlink(slot);
+	push_front(slot);
+      }
+      unsigned int victim() {return tail;}
+    };
+
+    /**
+     * This is the CLOCK approximation of LRU. Each slot has a
+     * reference bit, set at each hit. The clock hand sweeps the slots,
+     * clearing the bits, until it finds a cleared one.
+     */
+    class Clock {
+    private:
+      std::vector<bool> referenced;
+      unsigned int hand;
+
+    public:
+      Clock() : referenced(), hand(0) {}
+
+      void init(unsigned int nb_pages) {referenced.assign(nb_pages, false); hand = 0;}
+      void access() {}
+      void hit(unsigned int slot)  {referenced[slot] = true;}
+      void load(unsigned int slot) {referenced[slot] = true;}
+      unsigned int victim() {
+	while(referenced[hand]) {
+	  referenced[hand] = false;
+	  hand = (hand + 1) % referenced.size();
+	}
+	unsigned int res = hand;
+	hand = (hand + 1) % referenced.size();
+	return res;
+      }
+    };
+  }
+
+  /**
+   * These are the counters of a cache.
+   */
+  struct CacheStats {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    unsigned long prefetched;    // Pages loaded in advance.
+    unsigned long prefetch_hits; // Misses served by a page loaded in advance.
+    CacheStats() : hits(0), misses(0), evictions(0), prefetched(0), prefetch_hits(0) {}
+  };
+
+  namespace internal {
+
+    /**
+     * This loads pages in advance, on a background thread, into its
+     * own spare buffers. The cache asks for pages, and takes them
+     * when it needs them. The pages are loaded from a copy of the
+     * begin iterator, so the collection has to support reads from
+     * distinct iterators in distinct threads.
+     */
+    template<typename Iterator>
+    class Prefetcher {
+    public:
+      typedef typename Iterator::value_type value_type;
+
+    private:
+
+      enum class State {free, queued, loading, ready};
+
+      struct Spare {
+	std::vector<value_type> data;
+	unsigned int number;
+	State state;
+	unsigned long stamp;
+      };
+
+      Iterator begin;
+      int size;
+      int psize;
+      std::vector<Spare> spares;
+      unsigned long stamp;
+      unsigned long nb_prefetched;
+      bool stop;
+      std::mutex mutex;
+      std::condition_variable work;
+      std::condition_variable loaded;
+      std::thread worker;
+
+      // The oldest spare in the given state, or spares.end().
+      typename std::vector<Spare>::iterator oldest(State state) {
+	auto res = spares.end();
+	for(auto it = spares.begin(); it != spares.end(); ++it)
+	  if(it->state == state && (res == spares.end() || it->stamp < res->stamp))
+	    res = it;
+	return res;
+      }
+
+      typename std::vector<Spare>::iterator find(unsigned int number) {
+	for(auto it = spares.begin(); it != spares.end(); ++it)
+	  if(it->state != State::free && it->number == number)
+	    return it;
+	return spares.end();
+      }
+
+      void run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true) {
+	  auto it = spares.end();
+	  work.wait(lock, [this, &it]() {return stop || (it = oldest(State::queued)) != spares.end();});
+	  if(stop)
+	    return;
+	  it->state = State::loading;
+	  int first = psize * it->number;
+	  int last  = std::min(first + psize, size);
+	  std::vector<value_type> data;
+	  data.swap(it->data);
+	  lock.unlock();
+	  data.resize(last - first);
+	  Iterator from = begin + first;
+	  std::copy(from, from + (last - first), data.begin());
+	  lock.lock();
+	  it->data.swap(data);
+	  it->state = State::ready;
+	  ++nb_prefetched;
+	  loaded.notify_all();
+	}
+      }
+
+    public:
+
+      const unsigned int depth;
+
+      Prefetcher(const Iterator& begin, int size, int psize, unsigned int depth)
+	: begin(begin), size(size), psize(psize), spares(depth, Spare{{}, 0, State::free, 0}),
+	  stamp(0), nb_prefetched(0), stop(false), mutex(), work(), loaded(), worker(), depth(depth) {
+	worker = std::thread([this]() {run();});
+      }
+
+      Prefetcher(const Prefetcher&) = delete;
+      Prefetcher& operator=(const Prefetcher&) = delete;
+
+      ~Prefetcher() {
+	{
+	  std::lock_guard<std::mutex> lock(mutex);
+	  stop = true;
+	}
+	work.notify_all();
+	worker.join();
+      }
+
+      /**
+       * This asks for page number to be loaded. The request is
+       * ignored if the page is already asked for. Pages which are
+       * ready but not taken yet are recycled, the oldest first, when
+       * all the spares are busy.
+       */
+      void request(unsigned int number) {
+	{
+	  std::lock_guard<std::mutex> lock(mutex);
+	  if(find(number) != spares.end())
+	    return;
+	  auto it = oldest(State::free);
+	  if(it == spares.end())
+	    it = oldest(State::ready);
+	  if(it == spares.end())
+	    return;
+	  it->number = number;
+	  it->state  = State::queued;
+	  it->stamp  = stamp++;
+	}
+	work.notify_one();
+      }
+
+      /**
+       * If page number has been asked for, its values are swapped
+       * into data, waiting for the end of its loading if needed, and
+       * true is returned. A request which is not started yet is
+       * cancelled, and false is returned, as when the page has not
+       * been asked for.
+       */
+      bool take(unsigned int number, std::vector<value_type>& data) {
+	std::unique_lock<std::mutex> lock(mutex);
+	auto it = find(number);
+	if(it == spares.end())
+	  return false;
+	if(it->state == State::queued) {
+	  it->state = State::free;
+	  return false;
+	}
+	loaded.wait(lock, [it]() {return it->state == State::ready;});
+	data.swap(it->data);
+	it->state = State::free;
+	return true;
+      }
+
+      unsigned long prefetched() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return nb_prefetched;
+      }
+
+      void reset_prefetched() {
+	std::lock_guard<std::mutex> lock(mutex);
+	nb_prefetched = 0;
+      }
+    };
+  }
   
-  template<typename Iterator> class Cache;
+  template<typename Iterator, typename Policy> class Cache;
 
-  template<typename Iterator>
+  template<typename Iterator, typename Policy = eviction::Score>
   class CacheIterator {
   public:
     
@@ -51,11 +350,11 @@ namespace gaml {
   private:
 
     index_type idx;
-    Cache<Iterator>* cache;
+    Cache<Iterator,Policy>* cache;
     // mutable std::optional<value_type> value;
-    friend class Cache<Iterator>;
+    friend class Cache<Iterator,Policy>;
 
-    CacheIterator(index_type index, Cache<Iterator>* c) 
+    CacheIterator(index_type index, Cache<Iterator,Policy>* c) 
       : idx(index), cache(c) /*, value() */ {}
 
   public:                                  
@@ -98,154 +397,218 @@ namespace gaml {
 
 
   //#define mlDEBUG_CACHE
-  template<typename Iterator> 
+
+  /**
+   * This caches the values of a random access collection by pages of
+   * page_size consecutive values, nb_pages pages being kept in
+   * memory. A page table gives the slot of each cached page, so that
+   * a hit costs O(1). The page to be replaced by a new one is chosen
+   * by Policy (see gaml::eviction).
+   *
+   * Read-ahead can be enabled (see prefetch). The stride between the
+   * pages of successive accesses is then monitored, and when the
+   * same stride is observed twice, the next pages along that stride
+   * are loaded by a background thread.
+   */
+  template<typename Iterator, typename Policy = eviction::Score>
   class Cache {
 
   private:
 
     typedef int index_type;
 
-    friend class CacheIterator<Iterator>;
+    friend class CacheIterator<Iterator,Policy>;
 
     class Page {
-    private:
-
-      void scoreInit(void)  {score = 0;}
-      void scoreHit(void)   {score++;}
-      void scoreNoHit(void) {score *= .9;}
-      void scoreLoad(void)  {scoreInit();}
-
     public:
 
       typedef typename Iterator::value_type value_type;
 
       std::vector<typename Iterator::value_type> data;
       index_type begin;
-      double score;
-      bool used;
 
       void load(const Iterator& it, index_type idx, unsigned int size) {
 	data.resize(size);
 	std::copy(it,it+size,data.begin());
 	begin = idx;
-	scoreLoad();
-	used = true;
-      }
-
-      bool has(index_type idx) const {
-	return used && idx >= begin && idx-begin < (index_type)(data.size());
-      }
-
-      void noHit(void) {if(used) scoreNoHit();}
-
-      // has method call must have returned true
-      const typename Iterator::value_type& get(index_type idx) {
-	scoreHit();
-	return data[idx-begin];
       }
     };
 
+    static constexpr unsigned int no_slot = std::numeric_limits<unsigned int>::max();
+
     Iterator _begin;
     index_type size;
     index_type psize;
     typedef std::vector<Page> pages_type;
 
     pages_type pages;
+    std::vector<unsigned int> table;       // page number -> slot, or no_slot.
+    std::vector<unsigned int> page_number; // slot -> page number, or no_slot.
+    unsigned int nb_used;
+    Policy policy;
+    CacheStats counters;
+    std::unique_ptr<internal::Prefetcher<Iterator>> prefetcher;
+    unsigned int last_number;
+    long stride;
+
+    // This is called when the accessed page changes, in order to
+    // detect a stride and ask for the pages ahead.
+    void read_ahead(unsigned int number) {
+      long delta = (long)number - (long)last_number;
+      if(delta == stride) {
+	long n = number;
+	for(unsigned int k = 0; k < prefetcher->depth; ++k) {
+	  n += stride;
+	  if(n < 0 || n >= (long)table.size())
+	    break;
+	  if(table[n] == no_slot)
+	    prefetcher->request(n);
+	}
+      }
+      stride      = delta;
+      last_number = number;
+    }
 
     const typename Iterator::value_type& at(index_type i) {
-      bool page_not_found;
-      typename std::vector<Page>::iterator pi,pe,pfound;
-
-      for(page_not_found=true,pi=pages.begin(),pe=pages.end();
-	  pi != pe;
-	  (*pi).noHit(),++pi)
-	if(page_not_found && (*pi).has(i)) {
-	  page_not_found = false;
-	  pfound = pi; // Do not break here, since noHit has to be called.
-	}
+      unsigned int number = i/psize;
+      unsigned int slot   = table[number];
+      policy.access();
 
+      if(slot != no_slot) {
 #ifdef mlDEBUG_CACHE
-      if(!page_not_found)
 	std::cout << "index " << i << " is cached." << std::endl;
 #endif
-      
-      if(!page_not_found)
-	return (*pfound).get(i);
-
-      // Let us find the lowest scored page.
+	++counters.hits;
+	policy.hit(slot);
+	if(prefetcher && number != last_number)
+	  read_ahead(number);
+	return pages[slot].data[i - pages[slot].begin];
+      }
 
 #ifdef mlDEBUG_CACHE
       std::cout << "No page handles index " << i << std::endl;
 #endif
 
-      pi = pages.begin();
-      bool no_unused_page_found = true;
-      double min_score;
-      pfound = pi;
-      if(!(*pi).used)
-	 no_unused_page_found = false;
-      else
-	min_score = (*pi).score;
-	
-      for(++pi ; no_unused_page_found && pi != pe ; ++pi) 
-	if(!(*pi).used) {
-	  no_unused_page_found = false;
-	  pfound = pi;
-	}
-	else if((*pi).score < min_score) {
-	  min_score = (*pi).score;
-	  pfound = pi;
-	}
-
+      ++counters.misses;
+      if(nb_used < pages.size()) {
+	slot = nb_used++;
 #ifdef mlDEBUG_CACHE
-      if(!no_unused_page_found)
-	std::cout << "Unused page " << std::distance(pages.begin(),pfound) << " found" << std::endl;
-      else
-	std::cout << "Recycling page " << std::distance(pages.begin(),pfound) << std::endl;
+	std::cout << "Unused page " << slot << " found" << std::endl;
 #endif
+      }
+      else {
+	slot = policy.victim();
+	table[page_number[slot]] = no_slot;
+	++counters.evictions;
+#ifdef mlDEBUG_CACHE
+	std::cout << "Recycling page " << slot << std::endl;
+#endif
+      }
 	
-      
       // Let us load it.
 
-      index_type first = psize*(i/psize);
+      index_type first = psize*number;
       index_type last  = first + psize;
       if(last > size)
 	last = size;
 
 #ifdef mlDEBUG_CACHE
-      std::cout << "Loading [" << first << ".." << last << "[ into page " << std::distance(pages.begin(),pfound) << std::endl;
+      std::cout << "Loading [" << first << ".." << last << "[ into page " << slot << std::endl;
 #endif
 
-      (*pfound).load(_begin+first,first,last-first);
-      
-      return (*pfound).get(i);
+      if(prefetcher && prefetcher->take(number, pages[slot].data)) {
+	pages[slot].begin = first;
+	++counters.prefetch_hits;
+      }
+      else
+	pages[slot].load(_begin+first,first,last-first);
+      table[number]     = slot;
+      page_number[slot] = number;
+      policy.load(slot);
+      policy.hit(slot);
+      // The read-ahead is asked for once the page is taken, so that
+      // its spare buffer cannot be recycled.
+      if(prefetcher && number != last_number)
+	read_ahead(number);
+
+      return pages[slot].data[i - first];
     }
 
   public:
-    typedef CacheIterator<Iterator> iterator;
+    typedef CacheIterator<Iterator,Policy> iterator;
     
     Cache(const Iterator& begin_iter, 
 	  const Iterator& end_iter,
 	  unsigned int page_size,
 	  unsigned int nb_pages) : 
-      _begin(begin_iter), size((index_type)(std::distance(begin_iter,end_iter))), psize(page_size), pages(nb_pages) {
-      
-      typename pages_type::iterator pi,pend;
-      for(pi = pages.begin(), pend = pages.end(); pi != pend; ++pi) 
-	(*pi).used = false;
+      _begin(begin_iter), size((index_type)(std::distance(begin_iter,end_iter))), psize(page_size), pages(nb_pages),
+      table((size + psize - 1)/psize, no_slot), page_number(nb_pages, no_slot), nb_used(0), policy(), counters(),
+      prefetcher(), last_number(0), stride(0) {
+      policy.init(nb_pages);
+    }
+
+    /**
+     * The copy does not share the read-ahead thread of other, it
+     * starts its own one if other prefetches.
+     */
+    Cache(const Cache& other) :
+      _begin(other._begin), size(other.size), psize(other.psize), pages(other.pages),
+      table(other.table), page_number(other.page_number), nb_used(other.nb_used), policy(other.policy), counters(other.counters),
+      prefetcher(), last_number(other.last_number), stride(other.stride) {
+      if(other.prefetcher)
+	prefetch(other.prefetcher->depth);
+    }
+
+    Cache(Cache&&)            = default;
+    Cache& operator=(Cache&&) = default;
+    Cache& operator=(const Cache& other) {
+      if(this != &other)
+	*this = Cache(other);
+      return *this;
+    }
+
+    /**
+     * This enables read-ahead: up to nb_pages_ahead pages are loaded
+     * in advance by a background thread, into buffers of their
+     * own. The collection must support reads from distinct iterators
+     * in distinct threads (e.g. the iterators of a
+     * gaml::IndexedDataset open their own files), while the reader
+     * goes on with the cached pages. 0 disables read-ahead.
+     */
+    void prefetch(unsigned int nb_pages_ahead) {
+      prefetcher.reset();
+      if(nb_pages_ahead > 0)
+	prefetcher = std::make_unique<internal::Prefetcher<Iterator>>(_begin, size, psize, nb_pages_ahead);
     }
     
-    iterator begin() {return CacheIterator<Iterator>(0,this); }
-    iterator end()   {return CacheIterator<Iterator>(size,this); }
+    iterator begin() {return CacheIterator<Iterator,Policy>(0,this); }
+    iterator end()   {return CacheIterator<Iterator,Policy>(size,this); }
+
+    /**
+     * @returns the hit, miss, eviction and read-ahead counters.
+     */
+    CacheStats stats() const {
+      CacheStats res = counters;
+      if(prefetcher)
+	res.prefetched = prefetcher->prefetched();
+      return res;
+    }
+    void reset_stats() {
+      counters = CacheStats();
+      if(prefetcher)
+	prefetcher->reset_prefetched();
+    }
   };
   
   /**
-   * The Iterator type must be a random access iterator.
+   * The Iterator type must be a random access iterator. The eviction
+   * policy can be given as the first template argument, e.g.
+   * gaml::cache<gaml::eviction::LRU>(begin, end, page_size, nb_pages).
    */
-  template<typename Iterator>
-  Cache<Iterator> cache(const Iterator& begin, const Iterator& end,
-			unsigned int page_size,
-			unsigned int nb_pages) {
-    return Cache<Iterator>(begin,end,page_size,nb_pages);
+  template<typename Policy = eviction::Score, typename Iterator>
+  Cache<Iterator,Policy> cache(const Iterator& begin, const Iterator& end,
+			       unsigned int page_size,
+			       unsigned int nb_pages) {
+    return Cache<Iterator,Policy>(begin,end,page_size,nb_pages);
   }
 }
@@ -0,0 +1,469 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2012,  Supelec
+ *
+ *   Authors : Hervé Frezza-Buet, Frédéric Pennerath
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : herve.frezza-buet@supelec.fr, frederic.pennerath@supelec.fr
+ *
+ */
+
+#include <gamlMapped.hpp>
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <utility>
+#include <iterator>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+#include <limits>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+namespace gaml {
+
+  /**
+   * This is a compressed binary format for numerical datasets, made
+   * of (input, output) samples whose input is a fixed size container
+   * of numbers (std::array, std::vector...) and whose output is a
+   * number. The samples are stored by chunks of chunk_size
+   * samples. In a chunk, each input attribute and the output are
+   * stored as a compressed column. The file is:
+   *
+   * - a header,
+   * - the column blocks of the chunks, each one aligned on 8 bytes,
+   * - the index : the offsets of the nb_chunks*(dim+1) blocks,
+   * - a footer, giving the number of samples and the index position.
+   *
+   * Each block is encoded by the first applicable codec:
+   *
+   * - integers : values are integers, they are stored as bit-packed
+   *   differences to the minimal value,
+   * - floats   : values are exact floats, their 32 bits are stored
+   *   bit-packed, xored with the bits of the first value,
+   * - doubles  : their 64 bits are stored bit-packed, xored with the
+   *   bits of the first value.
+   *
+   * All the values of a block are packed with the same number of
+   * bits, so that any value can be decoded without the others: the
+   * dataset is a random access one, and it can be used with
+   * gaml::Tabular, gaml::shuffle, gaml::partition... A file is read
+   * by mapping it in memory.
+   *
+   * The file is native: it can only be read on a platform with the
+   * same byte order.
+   */
+  namespace columnar {
+
+    constexpr std::uint32_t version    = 1;
+    constexpr std::uint32_t byte_order = 0x01020304;
+    constexpr char          magic[8]   = {'g','a','m','l','c','o','l','f'};
+
+    struct Header {
+      char          magic[8];
+      std::uint32_t version;
+      std::uint32_t byte_order;
+      std::uint32_t dim;
+      std::uint32_t chunk_size;
+    };
+
+    struct Footer {
+      std::uint64_t nb_samples;
+      std::uint64_t nb_chunks;
+      std::uint64_t index_offset;
+      char          magic[8];
+    };
+
+    namespace internal {
+
+      enum class Codec : std::uint8_t {integers = 0, floats = 1, doubles = 2};
+
+      struct BlockHeader {
+	Codec         codec;
+	std::uint8_t  width;
+	std::uint8_t  reserved[6];
+	std::uint64_t base;
+      };
+
+      inline void pad(std::ostream& os, std::uint64_t start) {
+	static const char zeros[8] = {0,0,0,0,0,0,0,0};
+	auto pos = (std::uint64_t)os.tellp() - start;
+	if(pos % 8 != 0)
+	  os.write(zeros, 8 - pos % 8);
+      }
+
+      inline bool is_integer(double v) {
+	return v == std::trunc(v) && std::fabs(v) < 9007199254740992.0 && !(v == 0 && std::signbit(v));
+      }
+
+      inline bool is_float(double v) {
+	return (double)((float)v) == v;
+      }
+
+      inline std::uint64_t bits_of(double v) {std::uint64_t b; std::memcpy(&b, &v, sizeof(b)); return b;}
+      inline std::uint32_t bits_of(float  v) {std::uint32_t b; std::memcpy(&b, &v, sizeof(b)); return b;}
+
+      /**
+       * This writes the block of the n values.
+       */
+      inline void encode(std::ostream& os, const double* values, std::size_t n) {
+	BlockHeader h;
+	std::memset(&h, 0, sizeof(BlockHeader));
+	std::vector<std::uint64_t> codes(n);
+	if(std::all_of(values, values + n, is_integer)) {
+	  h.codec = Codec::integers;
+	  std::int64_t min = (std::int64_t)(*std::min_element(values, values + n));
+	  h.base = (std::uint64_t)min;
+	  for(std::size_t i = 0; i < n; ++i)
+	    codes[i] = (std::uint64_t)((std::int64_t)(values[i])) - h.base;
+	}
+	else if(std::all_of(values, values + n, is_float)) {
+	  h.codec = Codec::floats;
+	  h.base = bits_of((float)(values[0]));
+	  for(std::size_t i = 0; i < n; ++i)
+	    codes[i] = bits_of((float)(values[i])) ^ h.base;
+	}
+	else {
+	  h.codec = Codec::doubles;
+	  h.base = bits_of(values[0]);
+	  for(std::size_t i = 0; i < n; ++i)
+	    codes[i] = bits_of(values[i]) ^ h.base;
+	}
+	std::uint64_t all = 0;
+	for(auto code : codes)
+	  all |= code;
+	h.width = std::bit_width(all);
+
+	std::vector<std::uint64_t> words((n * h.width + 63) / 64, 0);
+	if(h.width > 0)
+	  for(std::size_t i = 0; i < n; ++i) {
+	    std::uint64_t bit = i * h.width;
+	    unsigned int  off = bit % 64;
+	    words[bit / 64] |= codes[i] << off;
+	    if(off + h.width > 64)
+	      words[bit / 64 + 1] |= codes[i] >> (64 - off);
+	  }
+	os.write((const char*)(&h), sizeof(BlockHeader));
+	os.write((const char*)(words.data()), words.size() * sizeof(std::uint64_t));
+      }
+
+      /**
+       * This decodes the values of a block in the mapped file.
+       */
+      class Block {
+      private:
+	Codec         codec;
+	unsigned int  width;
+	std::uint64_t base;
+	std::uint64_t mask;
+	const char*   words;
+
+	std::uint64_t word(std::size_t w) const {
+	  std::uint64_t res;
+	  std::memcpy(&res, words + w * sizeof(std::uint64_t), sizeof(res));
+	  return res;
+	}
+
+	std::uint64_t code(std::size_t i) const {
+	  if(width == 0)
+	    return 0;
+	  std::uint64_t bit = i * width;
+	  unsigned int  off = bit % 64;
+	  std::uint64_t res = word(bit / 64) >> off;
+	  if(off + width > 64)
+	    res |= word(bit / 64 + 1) << (64 - off);
+	  return res & mask;
+	}
+
+      public:
+	Block() : codec(Codec::integers), width(0), base(0), mask(0), words(nullptr) {}
+
+	/**
+	 * @param end The end of the block, for checking.
+	 */
+	Block(const char* data, const char* end, std::size_t n) : Block() {
+	  BlockHeader h;
+	  if(end - data < (std::ptrdiff_t)sizeof(BlockHeader))
+	    throw std::runtime_error("gaml::columnar::load : the file is truncated.");
+	  std::memcpy(&h, data, sizeof(BlockHeader));
+	  if(h.codec > Codec::doubles || h.width > 64)
+	    throw std::runtime_error("gaml::columnar::load : bad block.");
+	  if((std::uint64_t)(end - data) < sizeof(BlockHeader) + (n * h.width + 63) / 64 * sizeof(std::uint64_t))
+	    throw std::runtime_error("gaml::columnar::load : the file is truncated.");
+	  codec = h.codec;
+	  width = h.width;
+	  base  = h.base;
+	  mask  = width == 64 ? std::numeric_limits<std::uint64_t>::max() : (std::uint64_t(1) << width) - 1;
+	  words = data + sizeof(BlockHeader);
+	}
+
+	double operator[](std::size_t i) const {
+	  switch(codec) {
+	  case Codec::integers:
+	    return (double)((std::int64_t)(base + code(i)));
+	  case Codec::floats: {
+	    std::uint32_t b = (std::uint32_t)(base ^ code(i));
+	    float v;
+	    std::memcpy(&v, &b, sizeof(v));
+	    return v;
+	  }
+	  default: {
+	    std::uint64_t b = base ^ code(i);
+	    double v;
+	    std::memcpy(&v, &b, sizeof(v));
+	    return v;
+	  }
+	  }
+	}
+      };
+
+      template<typename T, std::size_t N>
+      void resize(std::array<T,N>&, std::size_t) {}
+
+      template<typename X>
+      void resize(X& x, std::size_t n) {x.resize(n);}
+    }
+
+    /**
+     * This writes the samples of [begin, end) in the columnar
+     * format. The stream has to be opened in binary mode.
+     * @param input_of, output_of Tell the input and the output of a sample.
+     * @param chunk_size The number of samples of a chunk.
+     */
+    template<typename Iterator, typename fctINPUT_OF, typename fctOUTPUT_OF>
+    void write(std::ostream& os, const Iterator& begin, const Iterator& end,
+	       const fctINPUT_OF& input_of, const fctOUTPUT_OF& output_of,
+	       unsigned int chunk_size = 4096) {
+      if(chunk_size == 0)
+	throw std::runtime_error("gaml::columnar::write : the chunk size has to be positive.");
+      std::uint64_t start = os.tellp();
+      std::uint32_t dim = 0;
+      if(begin != end) {
+	auto&& x = input_of(*begin);
+	dim = std::distance(std::begin(x), std::end(x));
+      }
+
+      Header h;
+      std::memset(&h, 0, sizeof(Header));
+      std::memcpy(h.magic, magic, 8);
+      h.version    = version;
+      h.byte_order = byte_order;
+      h.dim        = dim;
+      h.chunk_size = chunk_size;
+      os.write((const char*)(&h), sizeof(Header));
+
+      // columns[dim] is the output.
+      std::vector<std::vector<double>> columns(dim + 1);
+      for(auto& column : columns)
+	column.reserve(chunk_size);
+      std::vector<std::uint64_t> index;
+      std::uint64_t nb_samples = 0;
+      auto write_chunk = [&]() {
+	for(auto& column : columns) {
+	  internal::pad(os, start);
+	  index.push_back((std::uint64_t)os.tellp() - start);
+	  internal::encode(os, column.data(), column.size());
+	  column.clear();
+	}
+      };
+
+      for(auto it = begin; it != end; ++it) {
+	auto&& x = input_of(*it);
+	auto c = columns.begin();
+	for(auto& attr : x) {
+	  if(c == columns.end() - 1)
+	    throw std::runtime_error("gaml::columnar::write : the inputs do not have the same size.");
+	  (c++)->push_back((double)attr);
+	}
+	if(c != columns.end() - 1)
+	  throw std::runtime_error("gaml::columnar::write : the inputs do not have the same size.");
+	c->push_back((double)(output_of(*it)));
+	if(++nb_samples % chunk_size == 0)
+	  write_chunk();
+      }
+      if(nb_samples % chunk_size != 0)
+	write_chunk();
+
+      internal::pad(os, start);
+      Footer f;
+      std::memset(&f, 0, sizeof(Footer));
+      f.nb_samples   = nb_samples;
+      f.nb_chunks    = index.size() / (dim + 1);
+      f.index_offset = (std::uint64_t)os.tellp() - start;
+      std::memcpy(f.magic, magic, 8);
+      os.write((const char*)(index.data()), index.size() * sizeof(std::uint64_t));
+      os.write((const char*)(&f), sizeof(Footer));
+      if(!os)
+	throw std::runtime_error("gaml::columnar::write : writing failed.");
+    }
+
+    /**
+     * This is a dataset read from a columnar file. The values are
+     * decoded at each access. Copies share the mapping.
+     */
+    template<typename X, typename Y>
+    class Dataset {
+    public:
+      using value_type = std::pair<X,Y>;
+
+    private:
+      std::shared_ptr<gaml::MappedFile> file;
+      std::vector<internal::Block>      blocks;
+      std::uint32_t                     dim_;
+      std::uint32_t                     chunk_size;
+      std::size_t                       size_;
+
+    public:
+      Dataset(const std::string& path)
+	: file(std::make_shared<gaml::MappedFile>(path)), blocks(), dim_(0), chunk_size(0), size_(0) {
+	if(file->size() < sizeof(Header) + sizeof(Footer))
+	  throw std::runtime_error("gaml::columnar::load : the file is too small.");
+	Header h;
+	Footer f;
+	std::memcpy(&h, file->data(), sizeof(Header));
+	std::memcpy(&f, file->end() - sizeof(Footer), sizeof(Footer));
+	if(std::memcmp(h.magic, magic, 8) != 0 || std::memcmp(f.magic, magic, 8) != 0)
+	  throw std::runtime_error("gaml::columnar::load : this is not a gaml columnar file.");
+	if(h.version != version)
+	  throw std::runtime_error("gaml::columnar::load : unsupported version.");
+	if(h.byte_order != byte_order)
+	  throw std::runtime_error("gaml::columnar::load : the file was written on an incompatible platform.");
+	if(h.chunk_size == 0 || f.nb_chunks != (f.nb_samples + h.chunk_size - 1) / h.chunk_size)
+	  throw std::runtime_error("gaml::columnar::load : bad footer.");
+	std::uint64_t nb_blocks = f.nb_chunks * (h.dim + 1);
+	if(f.index_offset + nb_blocks * sizeof(std::uint64_t) + sizeof(Footer) != file->size())
+	  throw std::runtime_error("gaml::columnar::load : the file is truncated.");
+
+	// An empty range is written with a null dimension, whatever the
+	// input type.
+	if(f.nb_samples > 0) {
+	  X x;
+	  internal::resize(x, h.dim);
+	  if((std::size_t)(std::distance(std::begin(x), std::end(x))) != h.dim)
+	    throw std::runtime_error("gaml::columnar::load : the inputs do not match the input type.");
+	}
+
+	dim_       = h.dim;
+	chunk_size = h.chunk_size;
+	size_      = f.nb_samples;
+	const char* blocks_end = file->data() + f.index_offset;
+	blocks.reserve(nb_blocks);
+	for(std::uint64_t b = 0; b < nb_blocks; ++b) {
+	  std::uint64_t offset;
+	  std::memcpy(&offset, blocks_end + b * sizeof(std::uint64_t), sizeof(offset));
+	  if(offset < sizeof(Header) || offset > f.index_offset)
+	    throw std::runtime_error("gaml::columnar::load : bad index.");
+	  std::uint64_t chunk = b / (h.dim + 1);
+	  std::size_t n = std::min<std::uint64_t>(chunk_size, size_ - chunk * chunk_size);
+	  blocks.emplace_back(file->data() + offset, blocks_end, n);
+	}
+      }
+
+      std::size_t size() const {return size_;}
+      unsigned int dim() const {return dim_;}
+
+      /**
+       * This decodes the sample at index i into value.
+       */
+      void read(std::size_t i, value_type& value) const {
+	if(i >= size_)
+	  throw std::out_of_range("gaml::columnar::Dataset : random access out of the dataset");
+	const internal::Block* block = blocks.data() + (i / chunk_size) * (dim_ + 1);
+	std::size_t row = i % chunk_size;
+	internal::resize(value.first, dim_);
+	for(auto& attr : value.first)
+	  attr = (typename std::decay<decltype(attr)>::type)((block++)->operator[](row));
+	value.second = (Y)((*block)[row]);
+      }
+
+      value_type operator[](std::size_t i) const {
+	value_type value;
+	read(i, value);
+	return value;
+      }
+
+      class iterator {
+      public:
+	using difference_type   = std::ptrdiff_t;
+	using value_type        = typename Dataset<X,Y>::value_type;
+	using pointer           = const value_type*;
+	using reference         = const value_type&;
+	using iterator_category = std::random_access_iterator_tag;
+
+      private:
+	const Dataset* dataset_;
+	std::ptrdiff_t currentIndex_;
+	mutable std::ptrdiff_t loadedIndex_;
+	mutable value_type value_;
+
+      public:
+	iterator() : dataset_(nullptr), currentIndex_(0), loadedIndex_(-1), value_() {}
+	iterator(const Dataset& dataset, std::ptrdiff_t index) : dataset_(&dataset), currentIndex_(index), loadedIndex_(-1), value_() {}
+	iterator(const iterator&)            = default;
+	iterator& operator=(const iterator&) = default;
+
+	const value_type& operator*() const {
+	  if(loadedIndex_ != currentIndex_) {
+	    dataset_->read(currentIndex_, value_);
+	    loadedIndex_ = currentIndex_;
+	  }
+	  return value_;
+	}
+	const value_type* operator->() const {return &(*(*this));}
+
+	iterator& operator++()                     {++currentIndex_;    return *this;}
+	iterator& operator--()                     {--currentIndex_;    return *this;}
+	iterator  operator++(int)                  {iterator it(*this); ++currentIndex_; return it;}
+	iterator  operator--(int)                  {iterator it(*this); --currentIndex_; return it;}
+	iterator& operator+=(std::ptrdiff_t i)     {currentIndex_ += i; return *this;}
+	iterator& operator-=(std::ptrdiff_t i)     {currentIndex_ -= i; return *this;}
+	iterator  operator+ (std::ptrdiff_t i) const {iterator it(*this); it += i; return it;}
+	iterator  operator- (std::ptrdiff_t i) const {iterator it(*this); it -= i; return it;}
+	value_type operator[](std::ptrdiff_t i) const {return (*dataset_)[currentIndex_ + i];}
+
+	std::ptrdiff_t operator-(const iterator& other) const {return currentIndex_ - other.currentIndex_;}
+
+	bool operator!=(const iterator& other) const {return currentIndex_ != other.currentIndex_;}
+	bool operator==(const iterator& other) const {return currentIndex_ == other.currentIndex_;}
+	bool operator< (const iterator& other) const {return currentIndex_ <  other.currentIndex_;}
+	bool operator> (const iterator& other) const {return currentIndex_ >  other.currentIndex_;}
+	bool operator<=(const iterator& other) const {return currentIndex_ <= other.currentIndex_;}
+	bool operator>=(const iterator& other) const {return currentIndex_ >= other.currentIndex_;}
+      };
+
+      iterator begin() const {return iterator(*this, 0);}
+      iterator end()   const {return iterator(*this, size_);}
+    };
+
+    /**
+     * This loads a columnar file.
+     */
+    template<typename X, typename Y>
+    Dataset<X,Y> load(const std::string& path) {
+      return Dataset<X,Y>(path);
+    }
+  }
+}
@@ -34,6 +34,12 @@
 #include<stdexcept>
 #include<iterator>
 #include<utility>
+#include<sstream>
+#include<fstream>
+#include<algorithm>
+#include<thread>
+#include<mutex>
+#include<exception>
 
 namespace gaml {
 
@@ -49,6 +55,21 @@ namespace gaml {
     std::string indexFileName_;
     int size_;
 
+    // When the parser has a record size (see gaml::has_record_size),
+    // records are located from the end of the header, and no index
+    // file is built nor read.
+    using fixed_records = has_record_size<Parser>;
+    std::streamoff header_;
+
+    // The appended records are serialized in pendingData_ first,
+    // which is written at appendEnd_ in the data file when it exceeds
+    // bufferSize_ bytes. Their positions stay in pendingIndex_ until
+    // they are committed.
+    std::ostringstream pendingData_;
+    std::vector<std::streampos> pendingIndex_;
+    std::streampos appendEnd_;
+    std::size_t bufferSize_;
+
     void openDataFile(std::fstream& dataFile, std::fstream::openmode accessMode) {
       dataFile.open(dataFileName_, accessMode);
       if (!dataFile.is_open()) {
@@ -81,55 +102,86 @@ namespace gaml {
       size_ = indexFile_.tellg() / sizeof(std::streampos);
     }
 
-    void seek(int index) const {
-      if(index >= 0 && index < size_) {
-	indexFile_.seekg(index * sizeof(std::streampos));
-	std::streampos position;
-	indexFile_.read((char*) &position, sizeof(position));
-	dataFile_.seekg(position);
-      } else
-	throw std::ios_base::failure("random access out of indexed file");
+    void open(std::true_type) {
+      update();
     }
 
-  public:    
-    IndexedDataset(const data_file_parser_type& parser,
-		   const std::string& dataFileName, const std::string& indexFileName) :
-      parser_(parser), dataFile_(), indexFile_(), dataFileName_(dataFileName), indexFileName_(indexFileName)   {
+    void open(std::false_type) {
       if(doesFileExist(indexFileName_))
 	getSize();
       else
 	update();
     }
 
-    IndexedDataset(const IndexedDataset& other) :
-      parser_(other.parser_), dataFile_(), indexFile_(), dataFileName_(other.dataFileName_), indexFileName_(other.indexFileName_) {
-      if(doesFileExist(indexFileName_))
-	getSize();
-      else
-	update();
+    void openIndex(std::fstream&, std::true_type) {}
+
+    void openIndex(std::fstream& indexFile, std::false_type) {
+      openIndexFile(indexFile, std::fstream::in);
     }
 
-    ~IndexedDataset() {
-      dataFile_.close();
-      indexFile_.close();
+    std::streampos position(std::ptrdiff_t index, std::fstream&, std::true_type) const {
+      return header_ + (std::streamoff)index * (std::streamoff)(Parser::record_size);
     }
 
-    void update() {
+    std::streampos position(std::ptrdiff_t index, std::fstream& indexFile, std::false_type) const {
+      indexFile.seekg(index * sizeof(std::streampos));
+      std::streampos pos;
+      indexFile.read((char*) &pos, sizeof(pos));
+      return pos;
+    }
+
+    void seek(int index) const {
+      if(index >= 0 && index < size_) {
+	dataFile_.clear();
+	dataFile_.seekg(position(index, indexFile_, fixed_records()));
+      } else
+	throw std::ios_base::failure("random access out of indexed file");
+    }
+
+    template<typename Progress>
+    void update(unsigned int, const Progress& progress, std::true_type) {
+      if(dataFile_.is_open()) dataFile_.close();
+      if(indexFile_.is_open()) indexFile_.close();
+      openDataFile(dataFile_, std::fstream::in | std::fstream::out);
+      parser_.readBegin(dataFile_);
+      std::streampos begin = dataFile_.tellg();
+      dataFile_.clear();
+      dataFile_.seekg(0, dataFile_.end);
+      std::streampos end = dataFile_.tellg();
+      if(begin == std::streampos(-1) || begin > end) // Truncated header.
+	begin = end;
+      header_ = begin;
+      size_ = (end - begin) / (std::streamoff)(Parser::record_size);
+      progress((std::size_t)(end - begin), (std::size_t)(end - begin));
+    }
+
+    template<typename Progress>
+    void update(unsigned int nb_threads, const Progress& progress, std::false_type) {
       if(dataFile_.is_open()) dataFile_.close();
       if(indexFile_.is_open()) indexFile_.close();
       openDataFile(dataFile_, std::fstream::in );
-      openIndexFile(indexFile_, std::fstream::out);
 
-      value_type value;
-      size_ = 0;
       parser_.readBegin(dataFile_);
-      std::streampos position = dataFile_.tellg();
-      while(true) {
-	parser_.read(dataFile_, value);
-	size_ += 1;
-	indexFile_.write((const char*) &position, sizeof(position));
-	if(!parser_.readSeparator(dataFile_)) break;
-	position = dataFile_.tellg();
+      std::streampos first = dataFile_.tellg();
+      dataFile_.seekg(0, dataFile_.end);
+      std::streampos end = dataFile_.tellg();
+      dataFile_.seekg(first);
+
+      std::streamoff length = end - first;
+      std::streamoff done = 0;
+      std::mutex progress_mutex;
+      auto report = [&](std::streamoff bytes) {
+	std::lock_guard<std::mutex> lock(progress_mutex);
+	done += bytes;
+	progress((std::size_t)done, (std::size_t)length);
+      };
+      auto positions = index(nb_threads, first, end, report, has_resync<Parser>());
+
+      openIndexFile(indexFile_, std::fstream::out);
+      size_ = 0;
+      for(auto& chunk : positions) {
+	indexFile_.write((const char*)(chunk.data()), chunk.size() * sizeof(std::streampos));
+	size_ += chunk.size();
       }
       dataFile_.close();
       indexFile_.close();
@@ -137,6 +189,162 @@ namespace gaml {
       openIndexFile(indexFile_, std::fstream::in | std::fstream::out);
     }
 
+    // This collects the positions of the records starting in [begin,
+    // last), is being located at begin.
+    template<typename Report>
+    void indexRange(std::istream& is, std::streampos begin, std::streampos last,
+		    std::vector<std::streampos>& positions, const Report& report) const {
+      value_type value;
+      std::streampos position = begin;
+      std::streampos reported = begin;
+      while(position < last) {
+	parser_.read(is, value);
+	positions.push_back(position);
+	if(!parser_.readSeparator(is)) break;
+	position = is.tellg();
+	if(positions.size() % 1024 == 0) {
+	  report(position - reported);
+	  reported = position;
+	}
+      }
+      report(last - reported);
+    }
+
+    template<typename Report>
+    std::vector<std::vector<std::streampos>> index(unsigned int, std::streampos first, std::streampos end,
+						   const Report& report, std::false_type) {
+      std::vector<std::vector<std::streampos>> positions(1);
+      indexRange(dataFile_, first, end, positions[0], report);
+      return positions;
+    }
+
+    // The data is split into byte ranges. The chunk of a range
+    // gathers the records starting from the first record found by
+    // resync in that range, up to the first record of the next chunk.
+    template<typename Report>
+    std::vector<std::vector<std::streampos>> index(unsigned int nb_threads, std::streampos first, std::streampos end,
+						   const Report& report, std::true_type) {
+      const std::streamoff min_chunk_size = 1 << 20;
+      std::streamoff length = end - first;
+      unsigned int nb_chunks = (unsigned int)(std::min<std::streamoff>(nb_threads, length / min_chunk_size));
+      if(nb_chunks <= 1)
+	return index(nb_threads, first, end, report, std::false_type());
+
+      std::vector<std::streampos> starts(nb_chunks + 1);
+      starts[0]         = first;
+      starts[nb_chunks] = end;
+      for(unsigned int k = 1; k < nb_chunks; ++k) {
+	std::fstream is;
+	openDataFile(is, std::fstream::in);
+	// Starting one byte before the boundary, so that a record
+	// starting exactly at the boundary is found.
+	is.seekg(first + (std::streamoff)(length * k / nb_chunks) - 1);
+	if(parser_.resync(is)) starts[k] = std::max(is.tellg(), starts[k-1]);
+	else                   starts[k] = end;
+      }
+
+      std::vector<std::vector<std::streampos>> positions(nb_chunks);
+      std::vector<std::exception_ptr> errors(nb_chunks);
+      std::vector<std::thread> workers;
+      for(unsigned int k = 0; k < nb_chunks; ++k)
+	workers.emplace_back([&, k]() {
+	    try {
+	      std::fstream is;
+	      openDataFile(is, std::fstream::in);
+	      is.seekg(starts[k]);
+	      indexRange(is, starts[k], starts[k+1], positions[k], report);
+	    }
+	    catch(...) {
+	      errors[k] = std::current_exception();
+	    }
+	  });
+      for(auto& worker : workers)
+	worker.join();
+
+      for(auto& error : errors)
+	if(error)
+	  std::rethrow_exception(error);
+      return positions;
+    }
+
+    void indexRecords(std::true_type) {}
+
+    void indexRecords(std::false_type) {
+      indexFile_.clear();
+      indexFile_.seekp(0, indexFile_.end);
+      indexFile_.write((const char*)(pendingIndex_.data()), pendingIndex_.size() * sizeof(std::streampos));
+      indexFile_.flush();
+    }
+
+    void stage(const value_type& value) {
+      if(appendEnd_ == std::streampos(-1)) {
+	dataFile_.clear();
+	dataFile_.seekp(0, dataFile_.end);
+	appendEnd_ = dataFile_.tellp();
+      }
+      if(size_ + pendingIndex_.size() > 0)
+	parser_.writeSeparator(pendingData_);
+      pendingIndex_.push_back(appendEnd_ + (std::streamoff)(pendingData_.tellp()));
+      parser_.write(pendingData_, value);
+      if((std::size_t)(pendingData_.tellp()) >= bufferSize_)
+	flush();
+    }
+
+  public:    
+    IndexedDataset(const data_file_parser_type& parser,
+		   const std::string& dataFileName, const std::string& indexFileName) :
+      parser_(parser), dataFile_(), indexFile_(), dataFileName_(dataFileName), indexFileName_(indexFileName), size_(0), header_(0),
+      pendingData_(), pendingIndex_(), appendEnd_(-1), bufferSize_(0) {
+      open(fixed_records());
+    }
+
+    /**
+     * The copy only sees the committed records of other.
+     */
+    IndexedDataset(const IndexedDataset& other) :
+      parser_(other.parser_), dataFile_(), indexFile_(), dataFileName_(other.dataFileName_), indexFileName_(other.indexFileName_), size_(0), header_(0),
+      pendingData_(), pendingIndex_(), appendEnd_(-1), bufferSize_(other.bufferSize_) {
+      open(fixed_records());
+    }
+
+    ~IndexedDataset() {
+      try {
+	commit();
+      }
+      catch(...) {}
+      dataFile_.close();
+      indexFile_.close();
+    }
+
+    /**
+     * This rebuilds the index from the data file. For fixed-size
+     * records, only the number of records is recomputed. If the
+     * parser can resynchronize (see gaml::has_resync), the file is
+     * indexed by nb_threads threads, otherwise it is parsed
+     * sequentially.
+     * @param progress progress(bytes_done, bytes_total) is called
+     * along the indexing, from the indexing threads, one call at a
+     * time.
+     */
+    template<typename Progress>
+    void update(unsigned int nb_threads, const Progress& progress) {
+      commit();
+      appendEnd_ = -1;
+      update(std::max(1u, nb_threads), progress, fixed_records());
+    }
+
+    void update(unsigned int nb_threads) {
+      update(nb_threads, [](std::size_t, std::size_t) {});
+    }
+
+    /**
+     * This rebuilds the index with as many threads as the hardware
+     * supports.
+     */
+    void update() {
+      update(std::thread::hardware_concurrency());
+    }
+
     int size() const { return size_; }
 
     value_type operator[](std::size_t index) const {
@@ -146,15 +354,88 @@ namespace gaml {
       return value;
     }
 
+    /**
+     * This reads the values at indices [first, last) into out (a
+     * pointer to a caller buffer for example). The data file is
+     * sought once, the values are then parsed in sequence.
+     * @return The output iterator after the last written value.
+     */
+    template<typename OutputIterator>
+    OutputIterator read(std::size_t first, std::size_t last, OutputIterator out) const {
+      if(first >= last) return out;
+      if(last > (std::size_t)size_)
+	throw std::ios_base::failure("random access out of indexed file");
+      seek(first);
+      value_type value;
+      for(std::size_t i = first; i != last; ++i) {
+	if(i != first) parser_.readSeparator(dataFile_);
+	parser_.read(dataFile_, value);
+	*(out++) = value;
+      }
+      return out;
+    }
+
+    /**
+     * By default, each push_back is committed at once. With a non
+     * null buffer size, the appended records are gathered in memory
+     * and written to the data file by chunks of about nb_bytes. They
+     * are added to the dataset (and to the index) by commit only.
+     */
+    void set_buffer_size(std::size_t nb_bytes) {
+      bufferSize_ = nb_bytes;
+    }
+
+    /**
+     * This appends value to the data file, after a separator if the
+     * dataset is not empty. The value is committed at once if the
+     * buffer size is null.
+     */
     void push_back(const value_type& value) {
-      dataFile_.seekg(0, dataFile_.end);
-      std::streampos position = dataFile_.tellg();
-      indexFile_.seekg(0, indexFile_.end);
-      indexFile_.write((const char*) &position, sizeof(position));
-      parser_.write(dataFile_, value);
+      stage(value);
+      if(bufferSize_ == 0)
+	commit();
+    }
+
+    /**
+     * This appends the values in [begin, end), and commits them.
+     */
+    template<typename Iterator>
+    void append(Iterator begin, Iterator end) {
+      for(auto it = begin; it != end; ++it)
+	stage(*it);
+      commit();
+    }
+
+    /**
+     * This writes the appended records buffered so far to the data
+     * file. They are not committed yet.
+     */
+    void flush() {
+      std::string data = pendingData_.str();
+      if(data.size() == 0)
+	return;
+      dataFile_.clear();
+      dataFile_.seekp(appendEnd_);
+      dataFile_.write(data.data(), data.size());
       dataFile_.flush();
-      indexFile_.flush();
-      size_ += 1;
+      appendEnd_ += (std::streamoff)(data.size());
+      pendingData_.str("");
+    }
+
+    /**
+     * This flushes the appended records, and then writes their
+     * positions in the index file. The index is thus never ahead of
+     * the data, so that a reader opening the files meanwhile only
+     * sees complete records. The records are available from this
+     * dataset afterwards.
+     */
+    void commit() {
+      flush();
+      if(pendingIndex_.size() == 0)
+	return;
+      indexRecords(fixed_records());
+      size_ += pendingIndex_.size();
+      pendingIndex_.clear();
     }
 
     friend class iterator;
@@ -180,16 +461,14 @@ namespace gaml {
 	  if(!opened_) {
 	    fileDataset_->openDataFile(dataFile_, std::fstream::in);
 	    fileDataset_->parser_.readBegin(dataFile_);	    
-	    fileDataset_->openIndexFile(indexFile_, std::fstream::in);
+	    fileDataset_->openIndex(indexFile_, fixed_records());
 	    opened_ = true;
 	  }
 	  if(lastAccessedIndex_ != currentIndex_) {
 	    ++lastAccessedIndex_;
 	    if(currentIndex_ != lastAccessedIndex_) {
-	      indexFile_.seekg(currentIndex_ * sizeof(std::streampos));
-	      std::streampos position;
-	      indexFile_.read((char*) &position, sizeof(position));
-	      dataFile_.seekg(position);
+	      dataFile_.clear();
+	      dataFile_.seekg(fileDataset_->position(currentIndex_, indexFile_, fixed_records()));
 	      lastAccessedIndex_ = currentIndex_;
 	    }
 
@@ -37,6 +37,10 @@
 #include<stdexcept>
 #include<iterator>
 #include<utility>
+#include<streambuf>
+#include<charconv>
+#include<cstring>
+#include<type_traits>
 
 namespace gaml {
 
@@ -48,6 +52,187 @@ namespace gaml {
     }
   };
 
+  namespace internal {
+
+    /**
+     * This gives access to the get area of any stream buffer.
+     */
+    struct GetArea : public std::streambuf {
+      static char* begin(std::streambuf* buf)       {auto f = &GetArea::gptr;  return (buf->*f)();}
+      static char* end(std::streambuf* buf)         {auto f = &GetArea::egptr; return (buf->*f)();}
+      static void  bump(std::streambuf* buf, int n) {auto f = &GetArea::gbump; (buf->*f)(n);}
+    };
+
+    inline bool is_space(char c) {
+      return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    inline bool is_number_char(char c) {
+      return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.'
+	|| (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    /**
+     * This scans the characters buffered by the stream buffer of a
+     * stream directly, through a pointer, rather than extracting
+     * them one by one from the stream. The buffer is refilled when
+     * it is exhausted. What has been consumed is given back to the
+     * stream buffer when the cursor is destroyed, so that the stream
+     * can be used as usual afterwards. The cursor ignores the
+     * formatting flags of the stream, white spaces are skipped by
+     * peek. Nothing is read from a stream which is not good.
+     */
+    class Cursor {
+    private:
+      std::istream&   is;
+      std::streambuf* buf;
+      const char*     start;
+      const char*     p;
+      const char*     e;
+      char            single;   // For unbuffered stream buffers.
+      bool            unbuffered;
+      std::string     token;
+
+      void sync() {
+	if(unbuffered) {
+	  if(p == e)
+	    buf->sbumpc();
+	}
+	else if(p != start)
+	  GetArea::bump(buf, (int)(p - start));
+	start = p = e = nullptr;
+	unbuffered = false;
+      }
+
+      bool load() {
+	sync();
+	int c = buf->sgetc();
+	if(c == std::char_traits<char>::eof())
+	  return false;
+	const char* b = GetArea::begin(buf);
+	if(b != GetArea::end(buf)) {
+	  start = p = b;
+	  e = GetArea::end(buf);
+	}
+	else {
+	  single = (char)c;
+	  start = p = &single;
+	  e = p + 1;
+	  unbuffered = true;
+	}
+	return true;
+      }
+
+    public:
+      Cursor(std::istream& is) : is(is), buf(is.rdbuf()), start(nullptr), p(nullptr), e(nullptr),
+				 single(0), unbuffered(false), token() {
+	if(buf != nullptr && is.good())
+	  load();
+	else
+	  buf = nullptr;
+      }
+
+      ~Cursor() {
+	if(buf != nullptr) sync();
+      }
+
+      Cursor(const Cursor&)            = delete;
+      Cursor& operator=(const Cursor&) = delete;
+
+      /**
+       * This skips the white spaces and returns the next char, without
+       * consuming it. The eofbit of the stream is set at the end of
+       * the stream, and eof is returned.
+       */
+      int peek() {
+	while(true) {
+	  while(p != e && is_space(*p)) ++p;
+	  if(p != e)
+	    return (unsigned char)(*p);
+	  if(buf == nullptr)
+	    return std::char_traits<char>::eof();
+	  if(!load()) {
+	    is.setstate(std::ios::eofbit);
+	    return std::char_traits<char>::eof();
+	  }
+	}
+      }
+
+      /**
+       * This consumes the char returned by peek.
+       */
+      void skip() {++p;}
+
+      /**
+       * This appends to s the chars up to delim, which is consumed.
+       * @return false if the end of the stream is reached first.
+       */
+      template<typename STRING>
+      bool read_until(char delim, STRING& s) {
+	if(buf == nullptr)
+	  return false;
+	while(true) {
+	  const char* q = p == e ? e : (const char*)(std::memchr(p, delim, e - p));
+	  if(q != nullptr && q != e) {
+	    s.append(p, q);
+	    p = q + 1;
+	    return true;
+	  }
+	  s.append(p, e);
+	  p = e;
+	  if(!load()) {
+	    is.setstate(std::ios::eofbit);
+	    return false;
+	  }
+	}
+      }
+
+      /**
+       * This parses a number with std::from_chars. The whole number
+       * token has to be parsed.
+       */
+      template<typename T>
+      bool number(T& t) {
+	if(peek() == std::char_traits<char>::eof())
+	  return false;
+	const char* b = p;
+	const char* q = p;
+	while(q != e && is_number_char(*q)) ++q;
+	if(q != e)
+	  p = q;
+	else {
+	  // The token may go on in the next buffer.
+	  token.assign(p, e);
+	  p = e;
+	  while(load()) {
+	    q = p;
+	    while(q != e && is_number_char(*q)) ++q;
+	    token.append(p, q);
+	    p = q;
+	    if(q != e) break;
+	  }
+	  b = token.data();
+	  q = b + token.size();
+	}
+	if(b != q && *b == '+') ++b;
+	auto res = std::from_chars(b, q, t);
+	return res.ec == std::errc() && res.ptr == q && b != q;
+      }
+    };
+
+    template<typename T>
+    struct is_number : std::integral_constant<bool,
+					      std::is_arithmetic<T>::value
+					      && !std::is_same<T, bool>::value
+					      && !std::is_same<T, char>::value
+					      && !std::is_same<T, signed char>::value
+					      && !std::is_same<T, unsigned char>::value
+					      && !std::is_same<T, wchar_t>::value
+					      && !std::is_same<T, char8_t>::value
+					      && !std::is_same<T, char16_t>::value
+					      && !std::is_same<T, char32_t>::value> {};
+  }
+
   class ParserBase {
   protected:
 
@@ -67,18 +252,34 @@ namespace gaml {
       return formatError(is, std::string(msg));
     }
 
+    /**
+     * This skips the white spaces, and returns the next char without
+     * consuming it.
+     */
+    static int peek(std::istream& is) {
+      internal::Cursor cursor(is);
+      return cursor.peek();
+    }
+
     static char expect(std::istream& is, const char* chars,
 		       const char* msg = 0) {
-      char c;
-      is >> std::skipws >> c;
-      for (const char* ptr = chars; *ptr != 0; ++ptr) {
-	if (*ptr == -1) {
-	  if (is.eof())
-	    return -1;
-	} else if (*ptr == c)
-	  return c;
+      {
+	internal::Cursor cursor(is);
+	int c = cursor.peek();
+	for (const char* ptr = chars; *ptr != 0; ++ptr) {
+	  if (*ptr == -1) {
+	    if (c == std::char_traits<char>::eof()) {
+	      is.setstate(std::ios::failbit);
+	      return -1;
+	    }
+	  } else if (c != std::char_traits<char>::eof() && *ptr == (char)c) {
+	    cursor.skip();
+	    return (char)c;
+	  }
+	}
+	if (c == std::char_traits<char>::eof())
+	  is.setstate(std::ios::failbit);
       }
-      is.putback(c);
       std::string fullMessage;
       if (msg == 0) {
 	fullMessage = "char in \"";
@@ -148,9 +349,24 @@ namespace gaml {
   template<typename T> struct JSONParser: public ParserBase {
     typedef T value_type;
 
+  private:
+
+    void read(std::istream& is, T& t, std::false_type) const {
+      is >> t;
+    }
+
+    // Numbers are parsed from the stream buffer with std::from_chars.
+    void read(std::istream& is, T& t, std::true_type) const {
+      internal::Cursor cursor(is);
+      if (!cursor.number(t))
+	is.setstate(std::ios::failbit);
+    }
+
+  public:
+
     void read(std::istream& is, T& t) const {
       try {
-	is >> t;
+	read(is, t, typename internal::is_number<T>::type());
       } catch (const std::istream::failure& e) {
 	std::string message("parsing of type \"");
 	(message += typeid(T).name()) += "\" failed";
@@ -188,7 +404,22 @@ namespace gaml {
   template<typename Char> struct JSONParser<std::basic_string<Char>> : public ParserBase {
     typedef std::basic_string<Char> value_type;
 
-    void read(std::istream& is, std::basic_string<Char>& s) const {
+  private:
+
+    // The chars are appended by blocks, up to the closing quote.
+    void read(std::istream& is, std::basic_string<Char>& s, std::true_type) const {
+      expect(is, "\"", "a string"" starts with"" a quote");
+      s.clear();
+      bool closed;
+      {
+	internal::Cursor cursor(is);
+	closed = cursor.read_until('"', s);
+      }
+      if (!closed)
+	throw formatError(is, "a string"" ends with"" a quote");
+    }
+
+    void read(std::istream& is, std::basic_string<Char>& s, std::false_type) const {
       expect(is, "\"", "a string"" starts with"" a quote");
       is >> std::noskipws;
       s.clear();
@@ -206,6 +437,12 @@ namespace gaml {
       throw formatError(is, "a string"" ends with"" a quote");
     }
 
+  public:
+
+    void read(std::istream& is, std::basic_string<Char>& s) const {
+      read(is, s, typename std::is_same<Char, char>::type());
+    }
+
     void write(std::ostream& os, const std::basic_string<Char>& s) const {
       os << '"' << s << '"';
     }
@@ -222,10 +459,7 @@ namespace gaml {
       char c = expect(is, "[",
 		      "a vector" " starts with" " a left square bracket");
 
-      is >> std::skipws >> c;
-      if (c != ']') {
-	is.putback(c);
-
+      if (peek(is) != ']') {
 	std::back_insert_iterator<Seq> ii(seq);
 	sequence_value_type d;
 	while (is.good()) {
@@ -239,6 +473,7 @@ namespace gaml {
 	throw formatError(is,
 			  "a vector" " ends with" " a right square bracket");
       }
+      expect(is, "]");
     }
 
     void write(std::ostream& os, const Seq& seq) const {
@@ -316,9 +551,7 @@ namespace gaml {
       map.clear();
       char c = expect(is, "{", "a map" " starts with"" a left brace");
 
-      is >> std::skipws >> c;
-      if(c != '}') {
-	is.putback(c);
+      if(peek(is) != '}') {
 	std::pair<key_type, mapped_type> v;
 	while (is.good()) {
 	  keyParser_.read(is, v.first);
@@ -331,6 +564,7 @@ namespace gaml {
 	}
 	throw formatError(is, "a map" " ends with"" a right brace");
       }
+      expect(is, "}");
     }
 
     void write(std::ostream& os, const Map& map) const {
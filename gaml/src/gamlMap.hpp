@@ -27,6 +27,7 @@
 
 #include <iterator>
 #include <functional>
+#include <cstddef>
 
 namespace gaml {
   
@@ -40,11 +41,11 @@ namespace gaml {
 
   public:
 
-    using difference_type   = typename Iterator::difference_type ;
+    using difference_type   = typename std::iterator_traits<Iterator>::difference_type ;
     using value_type        = Return; 
     using pointer           = value_type*;
     using reference         = value_type&;
-    using iterator_category = typename Iterator::iterator_category;
+    using iterator_category = typename std::iterator_traits<Iterator>::iterator_category;
     
 
     MapIterator(void) : it(), f(), content() {}  
@@ -61,12 +62,19 @@ namespace gaml {
     }
 
     MapIterator& operator++() {++it; return *this;}
+    MapIterator& operator--() {--it; return *this;}
 
     MapIterator  operator++(int) {
       MapIterator res = *this;
       ++*this; 
       return res;
     }
+
+    MapIterator  operator--(int) {
+      MapIterator res = *this; 
+      --*this; 
+      return res;
+    }
     const value_type& operator*()                     const {content = f(*it); return content;}
 
     bool     operator==(const MapIterator& i) const {return it == i.it;}
@@ -87,11 +95,11 @@ namespace gaml {
 
   public:
     
-    using difference_type   = typename Iterator::difference_type ;
+    using difference_type   = typename std::iterator_traits<Iterator>::difference_type ;
     using value_type        = Return; 
     using pointer           = value_type*;
     using reference         = value_type&;
-    using iterator_category = typename Iterator::iterator_category;
+    using iterator_category = typename std::iterator_traits<Iterator>::iterator_category;
     
 
     MapIterator(void) : it(), f(), content() {}  
@@ -110,7 +118,7 @@ namespace gaml {
     MapIterator& operator++()                       {++it; return *this;}
     MapIterator& operator--()                       {--it; return *this;}
     MapIterator& operator+=(difference_type diff)   {it+=diff; return *this;}
-    MapIterator& operator-=(int diff)               {it-=diff; return *this;}
+    MapIterator& operator-=(difference_type diff)   {it-=diff; return *this;}
 
     MapIterator  operator++(int) {
       MapIterator res = *this;
@@ -128,8 +136,10 @@ namespace gaml {
     MapIterator       operator+(difference_type i)    const {return MapIterator(it+i,f);}
     MapIterator       operator-(difference_type i)    const {return MapIterator(it-i,f);}
     const value_type& operator*()                     const {content = f(*it); return content;}
+    value_type        operator[](difference_type i)   const {return f(it[i]);}
     bool     operator==(const MapIterator& i) const {return it == i.it;}
     bool     operator!=(const MapIterator& i) const {return it != i.it;}
+    bool     operator< (const MapIterator& i) const {return it <  i.it;}
   };
 
 
@@ -165,8 +175,16 @@ namespace gaml {
     
     iterator begin() const {return iterator(_begin, f); }
     iterator end() const   {return iterator(_end,   f); }
+
+    /**
+     * This is O(1) for random access iterators.
+     */
+    std::size_t size() const {return std::distance(_begin, _end);}
   };
   
+  /**
+   * The map iterators are of the category of the mapped ones.
+   */
   template<typename Iterator, typename Function>
   Map<Iterator,Function> map(const Iterator& begin, const Iterator& end, 
 			     const Function& fun) {
@@ -0,0 +1,129 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2012,  Supelec
+ *
+ *   Authors : Hervé Frezza-Buet, Frédéric Pennerath
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : herve.frezza-buet@supelec.fr, frederic.pennerath@supelec.fr
+ *
+ */
+
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <istream>
+#include <cstddef>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace gaml {
+
+  /**
+   * This is a read-only mapping of a whole file in memory. An empty
+   * file is mapped as a null range.
+   */
+  class MappedFile {
+  private:
+    const char* data_;
+    std::size_t size_;
+
+    static std::runtime_error error(const std::string& what, const std::string& fileName) {
+      std::stringstream ss;
+      ss << "Cannot " << what << " file \"" << fileName << "\"";
+      return std::runtime_error(ss.str().c_str());
+    }
+    
+  public:
+    MappedFile(const std::string& fileName) : data_(nullptr), size_(0) {
+      int fd = ::open(fileName.c_str(), O_RDONLY);
+      if(fd < 0)
+	throw error("open", fileName);
+      struct stat st;
+      if(::fstat(fd, &st) != 0) {
+	::close(fd);
+	throw error("stat", fileName);
+      }
+      size_ = st.st_size;
+      if(size_ > 0) {
+	void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+	if(addr == MAP_FAILED) {
+	  ::close(fd);
+	  throw error("map", fileName);
+	}
+	data_ = (const char*)addr;
+      }
+      ::close(fd);
+    }
+    
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    ~MappedFile() {
+      if(data_ != nullptr)
+	::munmap((void*)data_, size_);
+    }
+
+    const char* data() const {return data_;}
+    std::size_t size() const {return size_;}
+    const char* begin() const {return data_;}
+    const char* end()   const {return data_ + size_;}
+  };
+
+  /**
+   * This is a read-only stream buffer on a range of bytes, so that
+   * parsers can read from memory (e.g. a MappedFile) through a
+   * std::istream without any copy. The positions are offsets from
+   * the beginning of the range.
+   */
+  class SpanBuffer : public std::streambuf {
+  public:
+    SpanBuffer(const char* begin, const char* end) : std::streambuf() {
+      char* b = const_cast<char*>(begin);
+      setg(b, b, const_cast<char*>(end));
+    }
+
+    /**
+     * This moves the read position at offset pos.
+     */
+    void jump(std::size_t pos) {setg(eback(), eback() + pos, egptr());}
+
+  protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which = std::ios_base::in) override {
+      off_type base;
+      switch(dir) {
+      case std::ios_base::beg: base = 0;                break;
+      case std::ios_base::cur: base = gptr()  - eback(); break;
+      default:                 base = egptr() - eback(); break;
+      }
+      off_type pos = base + off;
+      if(!(which & std::ios_base::in) || pos < 0 || pos > egptr() - eback())
+	return pos_type(off_type(-1));
+      setg(eback(), eback() + pos, egptr());
+      return pos_type(pos);
+    }
+    
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) override {
+      return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+  };
+}
@@ -0,0 +1,322 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2012,  Supelec
+ *
+ *   Authors : Hervé Frezza-Buet, Frédéric Pennerath
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : herve.frezza-buet@supelec.fr, frederic.pennerath@supelec.fr
+ *
+ */
+
+#include <gamlMapped.hpp>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <iterator>
+#include <cstdint>
+#include <cstddef>
+
+namespace gaml {
+
+  /**
+   * This is an indexed dataset (see gaml::IndexedDataset) whose data
+   * and index files are mapped in memory. The index file starts with
+   * a header (a magic number, a format version and the size of the
+   * indexed data file), followed by an array of 64 bits offsets
+   * (native byte order). It is thus not compatible with the index
+   * files of gaml::IndexedDataset: an index file whose header does
+   * not match, as one written by gaml::IndexedDataset or one built
+   * for another version of the data file, is rebuilt when the
+   * dataset is opened. The values are parsed directly from the
+   * mapped bytes, through a gaml::SpanBuffer.
+   *
+   * The dataset only holds pointers to the mappings, which are
+   * shared, so that copying it costs nothing. The iterators point to
+   * the dataset, which must thus outlive them (as for the
+   * containers of the standard library). Accessing a value at
+   * random is a parse at a known address, without any seek nor
+   * system call.
+   *
+   * If the parser has a record size (see gaml::has_record_size), no
+   * index file is built nor mapped, the offsets are computed.
+   */
+  template<typename Parser>
+  class MappedIndexedDataset {
+  public:
+    typedef Parser data_file_parser_type;
+    using value_type = typename data_file_parser_type::value_type;
+
+  private:
+    
+    data_file_parser_type parser_;
+    std::string dataFileName_;
+    std::string indexFileName_;
+    std::shared_ptr<MappedFile> data_;
+    std::shared_ptr<MappedFile> index_;
+    const std::uint64_t* offsets_;
+    int size_;
+
+    using fixed_records = has_record_size<Parser>;
+    std::uint64_t header_;
+
+    // The index file header is {magic, version, data file size}, it
+    // keeps the offsets that follow it aligned.
+    static constexpr std::uint64_t index_magic   = 0x7864696d6c6d6167; // "gamlmidx"
+    static constexpr std::uint64_t index_version = 1;
+    static constexpr std::size_t   index_header  = 3;
+
+    inline bool doesFileExist(const std::string& fileName) {
+      std::ifstream f(fileName.c_str());
+      return f.good();
+    }
+
+    // This maps the index file, it returns false if its header does
+    // not match the data file.
+    bool mapIndex() {
+      index_ = std::make_shared<MappedFile>(indexFileName_);
+      const std::uint64_t* words = (const std::uint64_t*)(index_->data());
+      if(index_->size() < index_header * sizeof(std::uint64_t)
+	 || index_->size() % sizeof(std::uint64_t) != 0
+	 || words[0] != index_magic
+	 || words[1] != index_version
+	 || words[2] != (std::uint64_t)(data_->size())) {
+	index_.reset();
+	return false;
+      }
+      offsets_ = words + index_header;
+      size_    = index_->size() / sizeof(std::uint64_t) - index_header;
+      return true;
+    }
+
+    // This parses the value at offset pos in the data file. It keeps
+    // the mapping it reads from alive.
+    struct Reader {
+      std::shared_ptr<MappedFile> data;
+      SpanBuffer buf;
+      std::istream is;
+      Reader(const std::shared_ptr<MappedFile>& data) : data(data), buf(data->begin(), data->end()), is(&buf) {}
+    };
+
+    std::uint64_t offset(std::size_t index, std::true_type) const {
+      return header_ + index * Parser::record_size;
+    }
+
+    std::uint64_t offset(std::size_t index, std::false_type) const {
+      return offsets_[index];
+    }
+
+    void read(Reader& reader, int index, value_type& value) const {
+      if(index < 0 || index >= size_)
+	throw std::ios_base::failure("random access out of indexed file");
+      reader.is.clear();
+      reader.buf.jump(offset(index, fixed_records()));
+      parser_.read(reader.is, value);
+    }
+
+    void open(std::true_type) {
+      update();
+    }
+
+    void open(std::false_type) {
+      if(!doesFileExist(indexFileName_) || !mapIndex())
+	update();
+    }
+
+    void update(std::true_type) {
+      data_ = std::make_shared<MappedFile>(dataFileName_);
+      header_ = data_->size();
+      if(data_->size() > 0) {
+	Reader reader(data_);
+	parser_.readBegin(reader.is);
+	std::streampos begin = reader.is.tellg();
+	if(begin != std::streampos(-1) && (std::uint64_t)begin < header_)
+	  header_ = begin;
+      }
+      size_ = (data_->size() - header_) / Parser::record_size;
+    }
+
+    void update(std::false_type) {
+      index_.reset();
+      data_ = std::make_shared<MappedFile>(dataFileName_);
+      std::vector<std::uint64_t> offsets;
+      if(data_->size() > 0) {
+	Reader reader(data_);
+	value_type value;
+	parser_.readBegin(reader.is);
+	std::uint64_t position = reader.is.tellg();
+	while(true) {
+	  parser_.read(reader.is, value);
+	  offsets.push_back(position);
+	  if(!parser_.readSeparator(reader.is)) break;
+	  position = reader.is.tellg();
+	}
+      }
+      {
+	std::ofstream indexFile(indexFileName_, std::ofstream::binary | std::ofstream::trunc);
+	if(!indexFile.is_open()) {
+	  std::stringstream ss;
+	  ss << "Index file \"" << indexFileName_ << "\" failed to open";
+	  throw std::runtime_error(ss.str().c_str());
+	}
+	std::uint64_t header[index_header] = {index_magic, index_version, (std::uint64_t)(data_->size())};
+	indexFile.write((const char*)header, sizeof(header));
+	indexFile.write((const char*)(offsets.data()), offsets.size() * sizeof(std::uint64_t));
+      }
+      if(!mapIndex()) {
+	std::stringstream ss;
+	ss << "Index file \"" << indexFileName_ << "\" could not be written";
+	throw std::runtime_error(ss.str().c_str());
+      }
+    }
+
+  public:
+    MappedIndexedDataset(const data_file_parser_type& parser,
+			 const std::string& dataFileName, const std::string& indexFileName) :
+      parser_(parser), dataFileName_(dataFileName), indexFileName_(indexFileName), data_(), index_(), offsets_(nullptr), size_(0), header_(0) {
+      data_ = std::make_shared<MappedFile>(dataFileName_);
+      open(fixed_records());
+    }
+
+    MappedIndexedDataset(const MappedIndexedDataset&)            = default;
+    MappedIndexedDataset& operator=(const MappedIndexedDataset&) = default;
+
+    /**
+     * This (re)maps the data file, and rebuilds the index by parsing
+     * it. For fixed-size records, only the number of records is
+     * recomputed.
+     */
+    void update() {
+      update(fixed_records());
+    }
+
+    int size() const { return size_; }
+
+    value_type operator[](std::size_t index) const {
+      Reader reader(data_);
+      value_type value;
+      read(reader, index, value);
+      return value;
+    }
+
+    /**
+     * This reads the values at indices [first, last) into out, see
+     * gaml::IndexedDataset::read.
+     */
+    template<typename OutputIterator>
+    OutputIterator read(std::size_t first, std::size_t last, OutputIterator out) const {
+      if(first >= last) return out;
+      if(last > (std::size_t)size_)
+	throw std::ios_base::failure("random access out of indexed file");
+      Reader reader(data_);
+      value_type value;
+      read(reader, first, value);
+      *(out++) = value;
+      for(std::size_t i = first + 1; i != last; ++i) {
+	parser_.readSeparator(reader.is);
+	parser_.read(reader.is, value);
+	*(out++) = value;
+      }
+      return out;
+    }
+
+    class iterator {
+    public:
+
+      using difference_type   = std::ptrdiff_t;
+      using value_type        = typename MappedIndexedDataset<Parser>::value_type; 
+      using pointer           = const value_type*;
+      using reference         = const value_type&;
+      using iterator_category = std::random_access_iterator_tag;
+
+    private:
+      
+      const MappedIndexedDataset* dataset_;
+      std::ptrdiff_t currentIndex_;
+      mutable std::ptrdiff_t loadedIndex_;
+      mutable value_type value_;
+      mutable std::unique_ptr<Reader> reader_;
+
+    public:
+
+      iterator() : dataset_(nullptr), currentIndex_(0), loadedIndex_(-1), value_(), reader_() {}
+      
+      iterator(const MappedIndexedDataset& dataset, std::ptrdiff_t index) :
+	dataset_(&dataset), currentIndex_(index), loadedIndex_(-1), value_(), reader_() {}
+
+      // The copies do not share the parsed value nor the reader.
+      iterator(const iterator& other) :
+	dataset_(other.dataset_), currentIndex_(other.currentIndex_), loadedIndex_(-1), value_(), reader_() {}
+
+      iterator& operator=(const iterator& other) {
+	dataset_      = other.dataset_;
+	currentIndex_ = other.currentIndex_;
+	loadedIndex_  = -1;
+	reader_.reset();
+	return *this;
+      }
+
+      const value_type& operator*() const {
+	// The dataset may have been remapped by update() since the
+	// last read.
+	if(reader_ && reader_->data != dataset_->data_) {
+	  reader_.reset();
+	  loadedIndex_ = -1;
+	}
+	if(loadedIndex_ != currentIndex_) {
+	  if(!reader_)
+	    reader_ = std::make_unique<Reader>(dataset_->data_);
+	  dataset_->read(*reader_, currentIndex_, value_);
+	  loadedIndex_ = currentIndex_;
+	}
+	return value_;
+      }
+
+      iterator& operator++()                     {++currentIndex_;    return *this;}
+      iterator& operator--()                     {--currentIndex_;    return *this;}
+      iterator& operator+=(std::ptrdiff_t i)     {currentIndex_ += i; return *this;}
+      iterator& operator-=(std::ptrdiff_t i)     {currentIndex_ -= i; return *this;}
+      iterator  operator+ (std::ptrdiff_t i) const {iterator it(*this); it += i; return it;}
+      iterator  operator- (std::ptrdiff_t i) const {iterator it(*this); it -= i; return it;}
+
+      std::ptrdiff_t operator-(const iterator& other) const {return currentIndex_ - other.currentIndex_;}
+
+      bool operator!=(const iterator& other) const {return currentIndex_ != other.currentIndex_;}
+      bool operator==(const iterator& other) const {return currentIndex_ == other.currentIndex_;}
+      bool operator< (const iterator& other) const {return currentIndex_ <  other.currentIndex_;}
+    };
+
+    iterator begin() const {
+      return iterator(*this, 0);
+    }
+
+    iterator end() const {
+      return iterator(*this, size_);
+    }
+  };
+
+  template<typename Parser>
+  MappedIndexedDataset<Parser> make_mapped_indexed_dataset(const Parser& parser,
+							   const std::string& dataFileName, const std::string& indexFileName) {
+    return MappedIndexedDataset<Parser>(parser, dataFileName, indexFileName);
+  }
+}
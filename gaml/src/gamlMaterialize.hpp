@@ -0,0 +1,183 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2012,  Supelec
+ *
+ *   Author : Hervé Frezza-Buet, Frédéric Pennerath 
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : herve.frezza-buet@supelec.fr, frederic.pennerath@supelec.fr
+ *
+ */
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <new>
+#include <cstddef>
+#include <type_traits>
+#include <gamlMap.hpp>
+#include <gamlCache.hpp>
+
+namespace gaml {
+
+  namespace internal {
+    
+    /**
+     * This allocates the buffers of materialized collections on cache
+     * line boundaries.
+     */
+    template<typename T, std::size_t ALIGNMENT = 64>
+    struct AlignedAllocator {
+      using value_type = T;
+      template<typename U> struct rebind {using other = AlignedAllocator<U, ALIGNMENT>;};
+
+      AlignedAllocator() = default;
+      template<typename U> AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) {}
+
+      T* allocate(std::size_t n) {
+	return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(std::max(ALIGNMENT, alignof(T)))));
+      }
+      void deallocate(T* p, std::size_t) {
+	::operator delete(p, std::align_val_t(std::max(ALIGNMENT, alignof(T))));
+      }
+
+      template<typename U> bool operator==(const AlignedAllocator<U, ALIGNMENT>&) const {return true;}
+      template<typename U> bool operator!=(const AlignedAllocator<U, ALIGNMENT>&) const {return false;}
+    };
+
+    template<typename Iterator, typename Buffer>
+    void reserve(const Iterator& begin, const Iterator& end, Buffer& buffer, std::random_access_iterator_tag) {
+      buffer.reserve(std::distance(begin, end));
+    }
+
+    template<typename Iterator, typename Buffer>
+    void reserve(const Iterator&, const Iterator&, Buffer&, std::input_iterator_tag) {}
+  }
+
+  /**
+   * This is a collection whose values are stored in a contiguous
+   * aligned buffer. It is obtained from gaml::materialize, that
+   * evaluates a chain of lazy views (maps, zips, merges, filters,
+   * tabular views...) once for all. The iterators are contiguous
+   * ones, so that learners scanning the data several times do not
+   * pay for the chain at each pass.
+   */
+  template<typename T>
+  class Materialized {
+  public:
+    using value_type = T;
+    using buffer_type = std::vector<T, internal::AlignedAllocator<T>>;
+    using iterator = typename buffer_type::const_iterator;
+
+  private:
+    buffer_type content;
+
+  public:
+
+    Materialized() : content() {}
+
+    template<typename Iterator>
+    Materialized(const Iterator& begin, const Iterator& end) : content() {
+      internal::reserve(begin, end, content, typename std::iterator_traits<Iterator>::iterator_category());
+      std::copy(begin, end, std::back_inserter(content));
+    }
+
+    Materialized(const Materialized&)            = default;
+    Materialized(Materialized&&)                 = default;
+    Materialized& operator=(const Materialized&) = default;
+    Materialized& operator=(Materialized&&)      = default;
+
+    iterator begin() const {return content.begin();}
+    iterator end()   const {return content.end();}
+
+    std::size_t size() const {return content.size();}
+    const value_type& operator[](std::size_t i) const {return content[i];}
+    const value_type* data() const {return content.data();}
+  };
+
+  /**
+   * This evaluates the collection [begin, end) once, and stores its
+   * values in a contiguous buffer.
+   */
+  template<typename Iterator>
+  Materialized<std::remove_cvref_t<typename std::iterator_traits<Iterator>::value_type>> materialize(const Iterator& begin, const Iterator& end) {
+    return Materialized<std::remove_cvref_t<typename std::iterator_traits<Iterator>::value_type>>(begin, end);
+  }
+
+  /**
+   * These are the storage policies of gaml::cached_map.
+   */
+  namespace storage {
+    
+    /**
+     * All the mapped values are computed at once, and stored in
+     * memory (see gaml::Materialized).
+     */
+    struct Memory {};
+
+    /**
+     * The mapped values are computed by pages, nb_pages of them being
+     * kept in memory (see gaml::Cache). This is for collections that
+     * do not fit in memory, a page being computed again when it is
+     * accessed after its eviction.
+     */
+    template<typename Policy = eviction::Score>
+    struct Paged {
+      unsigned int page_size;
+      unsigned int nb_pages;
+    };
+
+    inline Memory memory() {return Memory();}
+
+    template<typename Policy = eviction::Score>
+    Paged<Policy> paged(unsigned int page_size, unsigned int nb_pages) {
+      return Paged<Policy>{page_size, nb_pages};
+    }
+  }
+
+  /**
+   * This is gaml::map, whose values are computed once and stored
+   * according to the storage policy. The default is
+   * gaml::storage::memory().
+   */
+  template<typename Iterator, typename Function>
+  Materialized<std::remove_cvref_t<typename Map<Iterator,Function>::value_type>> cached_map(const Iterator& begin, const Iterator& end,
+											  const Function& fun) {
+    auto mapped = map(begin, end, fun);
+    return materialize(mapped.begin(), mapped.end());
+  }
+
+  template<typename Iterator, typename Function>
+  Materialized<std::remove_cvref_t<typename Map<Iterator,Function>::value_type>> cached_map(const Iterator& begin, const Iterator& end,
+											  const Function& fun,
+											  const storage::Memory&) {
+    return cached_map(begin, end, fun);
+  }
+
+  /**
+   * The Iterator type must be a random access iterator here.
+   */
+  template<typename Iterator, typename Function, typename Policy>
+  Cache<typename Map<Iterator,Function>::iterator, Policy> cached_map(const Iterator& begin, const Iterator& end,
+									const Function& fun,
+									const storage::Paged<Policy>& paged) {
+    auto mapped = map(begin, end, fun);
+    return cache<Policy>(mapped.begin(), mapped.end(), paged.page_size, paged.nb_pages);
+  }
+}
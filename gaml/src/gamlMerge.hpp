@@ -27,46 +27,93 @@
 
 #include<exception>
 #include<iterator>
+#include<cstddef>
+#include<gamlZip.hpp>
 
 
 namespace gaml {
 
 
+  /**
+   * This iterates on the first collection and then on the second
+   * one. The iterator is of the weakest category of the two
+   * iterators, e.g. it is a random access iterator, whose moves and
+   * differences are O(1), when both are.
+   */
   template<typename Iterator1, typename Iterator2>
   class MergeIterator {
     Iterator1 it1_, end1_;
     Iterator2 it2_, begin2_;
 
+    // This is the signed position from the junction of the two
+    // collections (negative in the first one).
+    long offset() const {
+      if(it1_ != end1_) return -(long)std::distance(it1_, end1_);
+      return std::distance(begin2_, it2_);
+    }
+
   public:
 
     using difference_type = long;
     using value_type        = typename std::iterator_traits<Iterator1>::value_type; 
     using pointer           = value_type*;
     using reference         = value_type&;
-    using iterator_category = std::input_iterator_tag;
+    using iterator_category = typename internal::weakest_category<typename std::iterator_traits<Iterator1>::iterator_category,
+								  typename std::iterator_traits<Iterator2>::iterator_category,
+								  std::random_access_iterator_tag>::type;
+
 
-    
 
     MergeIterator() : it1_(), end1_(), it2_(), begin2_() {}
     MergeIterator(const Iterator1& it1, const Iterator1& end1, const Iterator2& it2, const Iterator2& begin2) : it1_(it1), end1_(end1), it2_(it2), begin2_(begin2) {
     }
     MergeIterator(const MergeIterator& other) : it1_(other.it1_), end1_(other.end1_), it2_(other.it2_), begin2_(other.begin2_) {}
+    MergeIterator& operator=(const MergeIterator& other) = default;
     MergeIterator& operator++(void) {
       if(it1_ != end1_) ++it1_; else ++it2_;
       return *this;
     }
+    MergeIterator& operator--(void) {
+      if(it2_ != begin2_) --it2_; else --it1_;
+      return *this;
+    }
+    MergeIterator operator++(int) {MergeIterator res = *this; ++*this; return res;}
+    MergeIterator operator--(int) {MergeIterator res = *this; --*this; return res;}
+
+    MergeIterator& operator+=(difference_type diff) {
+      long pos = offset() + diff;
+      if(pos < 0) {
+	it1_ = end1_;
+	std::advance(it1_, pos);
+	it2_ = begin2_;
+      }
+      else {
+	it1_ = end1_;
+	it2_ = begin2_;
+	std::advance(it2_, pos);
+      }
+      return *this;
+    }
+    MergeIterator& operator-=(difference_type diff) {return *this += -diff;}
+    MergeIterator operator+(difference_type diff) const {MergeIterator res = *this; return res += diff;}
+    MergeIterator operator-(difference_type diff) const {MergeIterator res = *this; return res -= diff;}
+    difference_type operator-(const MergeIterator& other) const {return offset() - other.offset();}
 
     auto operator*(void) const -> decltype(*it1_)  {
       if(it1_ != end1_) return *it1_;
       else return *it2_;
     }
-    
+    auto operator[](difference_type diff) const -> decltype(*it1_) {return *(*this + diff);}
+
     bool operator!=(const MergeIterator& other) const {
       return (it1_ != other.it1_) || (it2_ != other.it2_);
     }
     bool operator==(const MergeIterator& other) const {
       return (it1_ == other.it1_) && (it2_ == other.it2_);
     }
+    bool operator<(const MergeIterator& other) const {
+      return offset() < other.offset();
+    }
 
   };
 
@@ -80,11 +127,14 @@ namespace gaml {
     Merge(const Iterator1& begin1, const Iterator1& end1, const Iterator2& begin2, const Iterator2& end2) : begin1_(begin1), end1_(end1), begin2_(begin2), end2_(end2) {}
     Merge(const Merge& other) : begin1_(other.begin1_), end1_(other.end1_), begin2_(other.begin2_), end2_(other.end2_) {}
 
-    size_t size() { return (end1_ - begin1_) + (end2_ - begin2_); }
-    bool empty() { return (end1_ == begin1_) && (end2_ == begin2_); }
+    /**
+     * This is O(1) for random access iterators.
+     */
+    std::size_t size() const { return std::distance(begin1_, end1_) + std::distance(begin2_, end2_); }
+    bool empty() const { return (end1_ == begin1_) && (end2_ == begin2_); }
 
-    iterator begin() { return MergeIterator<Iterator1,Iterator2>(begin1_, end1_, begin2_, begin2_); }
-    iterator end() { return MergeIterator<Iterator1,Iterator2>(end1_, end1_, end2_, begin2_); }
+    iterator begin() const { return MergeIterator<Iterator1,Iterator2>(begin1_, end1_, begin2_, begin2_); }
+    iterator end() const { return MergeIterator<Iterator1,Iterator2>(end1_, end1_, end2_, begin2_); }
   };
 
   template<typename Iterator1, typename Iterator2> 
@@ -35,6 +35,7 @@
 
 #include <gamlFilter.hpp>
 #include <gamlMap.hpp>
+#include <gamlBatch.hpp>
 
 
 namespace gaml {
@@ -158,6 +159,24 @@ namespace gaml {
 	return neg_class;
       }
 
+      /**
+       * The scores of a batch of inputs are computed at once.
+       */
+      template<typename InputIterator, typename OutputIterator>
+      void predict_batch(const InputIterator& begin, const InputIterator& end, OutputIterator out) const {
+	std::vector<double> scores;
+	InputIterator batch_begin = begin;
+	while(batch_begin != end) {
+	  unsigned int nb;
+	  InputIterator batch_end = gaml::batch_end(batch_begin, end, nb);
+	  scores.clear();
+	  gaml::predict_batch(sc, batch_begin, batch_end, std::back_inserter(scores));
+	  for(auto s : scores)
+	    *(out++) = decision(s) ? pos_class : neg_class;
+	  batch_begin = batch_end;
+	}
+      }
+
       const SCORER& scorer() const {return sc;}
     };
     
@@ -289,6 +308,40 @@ namespace gaml {
 					 [](const typename scorers_type::value_type& a, const typename scorers_type::value_type& b) -> bool {return a.second.second < b.second.second;});
 	  return argmax->first;
 	}
+
+	/**
+	 * Each scorer computes the scores of a whole batch of
+	 * inputs. Unlike operator(), this does not modify the
+	 * predictor.
+	 */
+	template<typename InputIterator, typename OutputIterator>
+	void predict_batch(const InputIterator& begin, const InputIterator& end, OutputIterator out) const {
+	  std::vector<std::vector<double>> scores(scorers.size());
+	  InputIterator batch_begin = begin;
+	  while(batch_begin != end) {
+	    unsigned int nb;
+	    InputIterator batch_end = gaml::batch_end(batch_begin, end, nb);
+	    auto score = scores.begin();
+	    for(auto& kv : scorers) {
+	      score->clear();
+	      gaml::predict_batch(kv.second.first, batch_begin, batch_end, std::back_inserter(*(score++)));
+	    }
+
+	    // As with std::max_element, the first best class wins.
+	    for(unsigned int i = 0; i < nb; ++i) {
+	      auto argmax = scorers.begin();
+	      auto kv     = scorers.begin();
+	      double best = scores[0][i];
+	      for(auto score = scores.begin(); score != scores.end(); ++score, ++kv)
+		if((*score)[i] > best) {
+		  best   = (*score)[i];
+		  argmax = kv;
+		}
+	      *(out++) = argmax->first;
+	    }
+	    batch_begin = batch_end;
+	  }
+	}
       };
 
 
@@ -390,6 +443,35 @@ namespace gaml {
 					 [](const typename vote_type::value_type& a, const typename vote_type::value_type& b) -> bool {return a.second < b.second;});
 	  return argmax->first;
 	}
+
+	/**
+	 * Each bi-class predictor processes a whole batch of inputs
+	 * before the votes are counted. Unlike operator(), this does
+	 * not modify the predictor.
+	 */
+	template<typename InputIterator, typename OutputIterator>
+	void predict_batch(const InputIterator& begin, const InputIterator& end, OutputIterator out) const {
+	  std::vector<std::vector<output_type>> predictions(predictors.size());
+	  vote_type batch_votes = votes;
+	  InputIterator batch_begin = begin;
+	  while(batch_begin != end) {
+	    unsigned int nb;
+	    InputIterator batch_end = gaml::batch_end(batch_begin, end, nb);
+	    for(unsigned int k = 0; k < predictors.size(); ++k) {
+	      predictions[k].clear();
+	      gaml::predict_batch(predictors[k], batch_begin, batch_end, std::back_inserter(predictions[k]));
+	    }
+
+	    for(unsigned int i = 0; i < nb; ++i) {
+	      for(auto& kv : batch_votes) kv.second = 0;
+	      for(auto& prediction : predictions) batch_votes[prediction[i]]++;
+	      auto argmax = std::max_element(batch_votes.begin(), batch_votes.end(),
+					     [](const typename vote_type::value_type& a, const typename vote_type::value_type& b) -> bool {return a.second < b.second;});
+	      *(out++) = argmax->first;
+	    }
+	    batch_begin = batch_end;
+	  }
+	}
       };
       
       template<typename LEARNER>
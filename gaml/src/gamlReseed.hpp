@@ -0,0 +1,71 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2012,  Supelec
+ *
+ *   Author : Hervé Frezza-Buet, Frédéric Pennerath 
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : herve.frezza-buet@supelec.fr, frederic.pennerath@supelec.fr
+ *
+ */
+
+#include <random>
+#include <type_traits>
+#include <utility>
+
+namespace gaml {
+  namespace bag {
+
+    template<typename T> using test_reseed = void;
+
+    /**
+     * has_reseed<T>::type is std::true_type if T provides a
+     * reseed(std::seed_seq&) method, and std::false_type otherwise.
+     */
+    template<typename T, typename = void>
+    struct has_reseed : std::false_type {};
+
+    template<typename T>
+    struct has_reseed<T, test_reseed<decltype(std::declval<T&>().reseed(std::declval<std::seed_seq&>()))> > : std::true_type {};
+
+    namespace internal {
+      template<typename T>
+      void reseed(T& t, std::seed_seq& seq, std::true_type)  {t.reseed(seq);}
+      template<typename T>
+      void reseed(T&,   std::seed_seq&,     std::false_type) {}
+    }
+
+    /**
+     * This reseeds the random generators held by t, if any (i.e. if
+     * t has a reseed method).
+     *
+     * A learner or a randomizer which draws random numbers should
+     * provide a reseed(std::seed_seq&) method, which reseeds its
+     * generator from the sequence. Algorithms that copy it in order
+     * to run the copies independently (gaml::bag::Learner,
+     * gaml::risk::CrossValidation) reseed each copy this way, so that
+     * the copies do not replicate the same random sequence nor share
+     * a generator between threads.
+     */
+    template<typename T>
+    void reseed(T& t, std::seed_seq& seq) {
+      internal::reseed(t, seq, typename has_reseed<T>::type());
+    }
+  }
+}
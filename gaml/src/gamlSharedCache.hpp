@@ -0,0 +1,309 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2012,  Supelec
+ *
+ *   Author : Hervé Frezza-Buet, Frédéric Pennerath 
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : herve.frezza-buet@supelec.fr, frederic.pennerath@supelec.fr
+ *
+ */
+
+
+#include <gamlCache.hpp>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+
+namespace gaml {
+
+  template<typename Iterator> class SharedCache;
+
+  /**
+   * This iterates on a SharedCache. The page of a value may be
+   * evicted by another thread as soon as it is read, so the value is
+   * copied into the iterator, and dereferencing returns a reference
+   * to that copy. It is valid until the iterator is dereferenced
+   * again.
+   */
+  template<typename Iterator>
+  class SharedCacheIterator {
+  public:
+    
+    using difference_type   = long;
+    using value_type        = typename std::iterator_traits<Iterator>::value_type; 
+    using pointer           = value_type*;
+    using reference         = const value_type&;
+    using iterator_category = std::random_access_iterator_tag;
+
+    using index_type = difference_type;
+
+  private:
+
+    index_type idx;
+    const SharedCache<Iterator>* cache;
+    mutable value_type value;
+    friend class SharedCache<Iterator>;
+
+    SharedCacheIterator(index_type index, const SharedCache<Iterator>* c) : idx(index), cache(c), value() {}
+
+  public:                                  
+
+    SharedCacheIterator(void) : idx(0), cache(nullptr), value() {}
+    SharedCacheIterator(const SharedCacheIterator& cp)            = default;
+    SharedCacheIterator& operator=(const SharedCacheIterator& cp) = default;  
+
+    SharedCacheIterator& operator++()                     {++idx;      return *this;}
+    SharedCacheIterator& operator--()                     {--idx;      return *this;}
+    SharedCacheIterator& operator+=(difference_type diff) {idx+=diff;  return *this;}
+    SharedCacheIterator& operator-=(difference_type diff) {idx-=diff;  return *this;}
+
+    SharedCacheIterator  operator++(int) {
+      SharedCacheIterator res = *this;
+      ++*this; 
+      return res;
+    }
+
+    SharedCacheIterator  operator--(int) {
+      SharedCacheIterator res = *this; 
+      --*this; 
+      return res;
+    }
+
+    difference_type     operator- (const SharedCacheIterator& i) const {return idx - i.idx;}
+    SharedCacheIterator operator+ (difference_type i)            const {return SharedCacheIterator(idx+i,cache);}
+    SharedCacheIterator operator- (difference_type i)            const {return SharedCacheIterator(idx-i,cache);}
+    bool                operator==(const SharedCacheIterator& i) const {return cache == i.cache && idx == i.idx;}
+    bool                operator!=(const SharedCacheIterator& i) const {return cache != i.cache || idx != i.idx;}
+
+    const value_type& operator*() const {
+      value = cache->at(idx);
+      return value;
+    }
+  };
+
+  /**
+   * This is a cache (see gaml::Cache) which can be shared by
+   * several threads, e.g. by the folds of a parallel
+   * cross-validation or the learners of a parallel bag.
+   *
+   * The pages are spread over nb_shards shards, page n belonging to
+   * shard n % nb_shards. Each shard has its own reader-writer
+   * lock. A hit only takes the shard lock in shared mode, so
+   * concurrent readers of cached pages do not serialize. The
+   * eviction is CLOCK (see gaml::eviction::Clock), since its
+   * reference bits can be set by concurrent hits.
+   *
+   * A page is loaded without holding the lock of its shard. The
+   * threads which miss a page being loaded wait for that load
+   * rather than loading the page again. As for read-ahead (see
+   * gaml::Cache::prefetch), the collection must support reads from
+   * distinct iterators in distinct threads.
+   */
+  template<typename Iterator>
+  class SharedCache {
+  public:
+    typedef typename std::iterator_traits<Iterator>::value_type value_type;
+    typedef SharedCacheIterator<Iterator>                       iterator;
+
+  private:
+
+    typedef int index_type;
+    friend class SharedCacheIterator<Iterator>;
+
+    static constexpr unsigned int no_slot = std::numeric_limits<unsigned int>::max();
+
+    struct Page {
+      std::vector<value_type> data;
+      unsigned int            number;
+      bool                    ready;
+    };
+
+    struct Shard {
+      mutable std::shared_mutex           mutex;
+      mutable std::condition_variable_any loaded;
+      std::vector<Page>                   pages;
+      std::unique_ptr<std::atomic<bool>[]> referenced;
+      unsigned int                        nb_used;
+      unsigned int                        hand;
+
+      Shard(unsigned int nb_pages) : mutex(), loaded(), pages(nb_pages, Page{{}, no_slot, false}),
+				     referenced(new std::atomic<bool>[nb_pages]), nb_used(0), hand(0) {
+	for(unsigned int s = 0; s < nb_pages; ++s)
+	  referenced[s].store(false, std::memory_order_relaxed);
+      }
+
+      // The lock is held in unique mode. This returns no_slot if all
+      // the pages are being loaded.
+      unsigned int victim() {
+	if(nb_used < pages.size())
+	  return nb_used++;
+	for(unsigned int step = 0; step < 2*pages.size(); ++step) {
+	  unsigned int slot = hand;
+	  hand = (hand + 1) % pages.size();
+	  if(pages[slot].ready && !referenced[slot].exchange(false, std::memory_order_relaxed))
+	    return slot;
+	}
+	for(unsigned int step = 0; step < pages.size(); ++step) {
+	  unsigned int slot = hand;
+	  hand = (hand + 1) % pages.size();
+	  if(pages[slot].ready)
+	    return slot;
+	}
+	return no_slot;
+      }
+    };
+
+    Iterator                              _begin;
+    index_type                            size;
+    index_type                            psize;
+    std::unique_ptr<unsigned int[]>       table; // page number -> slot in its shard, or no_slot.
+    std::vector<std::unique_ptr<Shard>>   shards;
+    mutable std::atomic<unsigned long>    hits;
+    mutable std::atomic<unsigned long>    misses;
+    mutable std::atomic<unsigned long>    evictions;
+
+    value_type at(index_type i) const {
+      unsigned int number = i/psize;
+      Shard& shard = *(shards[number % shards.size()]);
+      {
+	std::shared_lock<std::shared_mutex> lock(shard.mutex);
+	unsigned int slot = table[number];
+	if(slot != no_slot && shard.pages[slot].ready) {
+	  hits.fetch_add(1, std::memory_order_relaxed);
+	  shard.referenced[slot].store(true, std::memory_order_relaxed);
+	  return shard.pages[slot].data[i - number*psize];
+	}
+      }
+      return const_cast<SharedCache*>(this)->miss(shard, number, i);
+    }
+
+    value_type miss(Shard& shard, unsigned int number, index_type i) {
+      std::unique_lock<std::shared_mutex> lock(shard.mutex);
+      unsigned int slot;
+      while(true) {
+	slot = table[number];
+	if(slot != no_slot) {
+	  if(shard.pages[slot].ready) {
+	    // Another thread has loaded the page meanwhile.
+	    hits.fetch_add(1, std::memory_order_relaxed);
+	    shard.referenced[slot].store(true, std::memory_order_relaxed);
+	    return shard.pages[slot].data[i - number*psize];
+	  }
+	  shard.loaded.wait(lock);
+	  continue;
+	}
+	slot = shard.victim();
+	if(slot != no_slot)
+	  break;
+	shard.loaded.wait(lock);
+      }
+
+      misses.fetch_add(1, std::memory_order_relaxed);
+      Page& page = shard.pages[slot];
+      if(page.number != no_slot) {
+	table[page.number] = no_slot;
+	evictions.fetch_add(1, std::memory_order_relaxed);
+      }
+      page.number   = number;
+      page.ready    = false;
+      table[number] = slot;
+      std::vector<value_type> data;
+      data.swap(page.data);
+      lock.unlock();
+
+      index_type first = psize*number;
+      index_type last  = std::min(first + psize, size);
+      try {
+	data.resize(last - first);
+	Iterator it = _begin + first;
+	std::copy(it, it + (last - first), data.begin());
+      }
+      catch(...) {
+	lock.lock();
+	table[number] = no_slot;
+	page.number   = no_slot;
+	page.ready    = true; // The slot is free again, an empty page is never hit.
+	shard.loaded.notify_all();
+	throw;
+      }
+
+      value_type res = data[i - first];
+      lock.lock();
+      page.data.swap(data);
+      page.ready = true;
+      shard.referenced[slot].store(true, std::memory_order_relaxed);
+      shard.loaded.notify_all();
+      return res;
+    }
+
+  public:
+
+    SharedCache(const Iterator& begin_iter,
+		const Iterator& end_iter,
+		unsigned int page_size,
+		unsigned int nb_pages,
+		unsigned int nb_shards)
+      : _begin(begin_iter), size((index_type)(std::distance(begin_iter,end_iter))), psize(page_size),
+	table(), shards(), hits(0), misses(0), evictions(0) {
+      unsigned int nb_numbers = (size + psize - 1)/psize;
+      table.reset(new unsigned int[nb_numbers]);
+      std::fill(table.get(), table.get() + nb_numbers, no_slot);
+      nb_shards = std::max(1u, std::min(nb_shards, nb_pages));
+      for(unsigned int s = 0; s < nb_shards; ++s)
+	shards.push_back(std::make_unique<Shard>(std::max(1u, (nb_pages + nb_shards - 1 - s) / nb_shards)));
+    }
+
+    SharedCache(const SharedCache&)            = delete;
+    SharedCache& operator=(const SharedCache&) = delete;
+
+    iterator begin() const {return iterator(0,this);}
+    iterator end()   const {return iterator(size,this);}
+
+    /**
+     * @returns the hit, miss and eviction counters.
+     */
+    CacheStats stats() const {
+      CacheStats res;
+      res.hits      = hits.load();
+      res.misses    = misses.load();
+      res.evictions = evictions.load();
+      return res;
+    }
+    void reset_stats() {hits = 0; misses = 0; evictions = 0;}
+  };
+
+  /**
+   * The Iterator type must be a random access iterator. The nb_pages
+   * pages are spread over nb_shards shards (see gaml::SharedCache).
+   */
+  template<typename Iterator>
+  SharedCache<Iterator> shared_cache(const Iterator& begin, const Iterator& end,
+				     unsigned int page_size,
+				     unsigned int nb_pages,
+				     unsigned int nb_shards = 16) {
+    return SharedCache<Iterator>(begin,end,page_size,nb_pages,nb_shards);
+  }
+}
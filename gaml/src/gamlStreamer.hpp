@@ -35,6 +35,7 @@
 #include <utility>
 #include <memory>
 #include <iomanip>
+#include <type_traits>
 
 namespace gaml {
   /**
@@ -85,6 +86,46 @@ namespace gaml {
     void writeSeparator(std::ostream&) const {}
   };
 
+  /**
+   * A parser whose data all have the same size in the file may
+   * declare it as
+   *
+   * static constexpr std::size_t record_size = ...;
+   *
+   * The data then follows readBegin contiguously, each one taking
+   * record_size bytes (including the separator). Indexed datasets
+   * (see gaml::IndexedDataset) compute the positions of such records
+   * rather than storing them in an index file.
+   */
+  template<typename T> using test_record_size = void;
+
+  template<typename PARSER, typename = void>
+  struct has_record_size : std::false_type {};
+
+  template<typename PARSER>
+  struct has_record_size<PARSER, test_record_size<decltype(PARSER::record_size)>> : std::true_type {};
+
+  /**
+   * A parser may also provide
+   *
+   * bool resync(std::istream& is) const;
+   *
+   * which moves is, located anywhere in the data, to the beginning of
+   * the next record, i.e. where readSeparator would have left it
+   * after the previous one. It returns false if no record follows.
+   * Such a parser lets gaml::IndexedDataset index the data file in
+   * parallel, each thread resynchronizing at the beginning of its
+   * byte range. For line-based formats, resync skips the end of the
+   * current line.
+   */
+  template<typename T> using test_resync = void;
+
+  template<typename PARSER, typename = void>
+  struct has_resync : std::false_type {};
+
+  template<typename PARSER>
+  struct has_resync<PARSER, test_resync<decltype(std::declval<const PARSER&>().resync(std::declval<std::istream&>()))>> : std::true_type {};
+
   template<typename Parser> class InputDataStream : public Parser {
     void initInputStream() {
       // is_->exceptions(
@@ -27,6 +27,12 @@
 
 #include <iterator>
 #include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
 
 
 namespace gaml {
@@ -67,17 +73,151 @@ namespace gaml {
   
 
 
+  namespace internal {
+    // The membership bits of an index table, computed at the first
+    // request.
+    struct Membership {
+      std::once_flag             once;
+      std::vector<std::uint64_t> bits;
+    };
+  }
+
   /**
-   * Tabular iterator. It fits concepts::SecondaryIterator.
+   * This is the table of indices of a tabular view. It is stored as
+   * compactly as possible: a contiguous range of indices is stored as
+   * (start, length), and the indices are stored on 16 bits when they
+   * all fit. Membership tests (has) are done in constant time, from
+   * a bitset computed at the first test.
+   */
+  class IndexTable {
+  private:
+    std::vector<tabular_index_type>      wide;
+    std::vector<std::uint16_t>           narrow;
+    tabular_index_type                   start;
+    std::size_t                          length;
+    std::shared_ptr<internal::Membership> membership;
+
+  public:
+
+    class const_iterator {
+    private:
+      const tabular_index_type* wide;
+      const std::uint16_t*      narrow;
+      tabular_index_type        start;
+      std::ptrdiff_t            pos;
+
+    public:
+      using difference_type   = std::ptrdiff_t;
+      using value_type        = tabular_index_type;
+      using pointer           = const tabular_index_type*;
+      using reference         = tabular_index_type;
+      using iterator_category = std::random_access_iterator_tag;
+
+      const_iterator() : wide(nullptr), narrow(nullptr), start(0), pos(0) {}
+      const_iterator(const tabular_index_type* wide, const std::uint16_t* narrow, tabular_index_type start, std::ptrdiff_t pos)
+	: wide(wide), narrow(narrow), start(start), pos(pos) {}
+
+      tabular_index_type operator*() const {
+	if(wide   != nullptr) return wide[pos];
+	if(narrow != nullptr) return narrow[pos];
+	return start + pos;
+      }
+      tabular_index_type operator[](std::ptrdiff_t i) const {return *(*this + i);}
+
+      const_iterator& operator++()                 {++pos;       return *this;}
+      const_iterator& operator--()                 {--pos;       return *this;}
+      const_iterator  operator++(int)              {const_iterator res = *this; ++pos; return res;}
+      const_iterator  operator--(int)              {const_iterator res = *this; --pos; return res;}
+      const_iterator& operator+=(std::ptrdiff_t i) {pos += i;    return *this;}
+      const_iterator& operator-=(std::ptrdiff_t i) {pos -= i;    return *this;}
+      const_iterator  operator+(std::ptrdiff_t i) const {const_iterator res = *this; res.pos += i; return res;}
+      const_iterator  operator-(std::ptrdiff_t i) const {const_iterator res = *this; res.pos -= i; return res;}
+
+      std::ptrdiff_t operator-(const const_iterator& other) const {return pos - other.pos;}
+      bool operator==(const const_iterator& other) const {return pos == other.pos;}
+      bool operator!=(const const_iterator& other) const {return pos != other.pos;}
+      bool operator< (const const_iterator& other) const {return pos <  other.pos;}
+    };
+
+    IndexTable() : wide(), narrow(), start(0), length(0), membership(std::make_shared<internal::Membership>()) {}
+
+    IndexTable(std::vector<tabular_index_type>&& indices)
+      : wide(), narrow(), start(0), length(indices.size()), membership(std::make_shared<internal::Membership>()) {
+      bool is_range = true;
+      tabular_index_type max = 0;
+      for(std::size_t i = 0; i < length; ++i) {
+	is_range = is_range && indices[i] == indices[0] + i;
+	max = std::max(max, indices[i]);
+      }
+      if(is_range)
+	start = length == 0 ? 0 : indices[0];
+      else if(max <= 0xFFFF)
+	narrow.assign(indices.begin(), indices.end());
+      else
+	wide = std::move(indices);
+    }
+
+    IndexTable(const IndexTable&)            = default;
+    IndexTable(IndexTable&&)                 = default;
+    IndexTable& operator=(const IndexTable&) = default;
+    IndexTable& operator=(IndexTable&&)      = default;
+
+    std::size_t size() const {return length;}
+
+    const_iterator begin() const {
+      return const_iterator(wide.size()   > 0 ? wide.data()   : nullptr,
+			    narrow.size() > 0 ? narrow.data() : nullptr,
+			    start, 0);
+    }
+
+    const_iterator end() const {
+      return begin() + length;
+    }
+
+    tabular_index_type operator[](std::size_t i) const {return begin()[i];}
+
+    bool has(tabular_index_type idx) const {
+      if(wide.size() == 0 && narrow.size() == 0)
+	return idx >= start && idx - start < length;
+      auto& m = *membership;
+      std::call_once(m.once, [this, &m]() {
+	  tabular_index_type max = 0;
+	  for(auto i : *this) max = std::max(max, i);
+	  m.bits.assign(max / 64 + 1, 0);
+	  for(auto i : *this) m.bits[i / 64] |= std::uint64_t(1) << (i % 64);
+	});
+      return idx / 64 < m.bits.size() && ((m.bits[idx / 64] >> (idx % 64)) & 1);
+    }
+
+    std::vector<tabular_index_type> to_vector() const {
+      return std::vector<tabular_index_type>(begin(), end());
+    }
+  };
+
+  /**
+   * Tabular iterator. It fits concepts::SecondaryIterator. When the
+   * primary collection is contiguous (raw pointers, std::vector
+   * iterators...), dereferencing is a single indexed load.
    */
   template<typename Iterator>
   class TabularIterator {
   private:
     Iterator                                        begin;
     mutable Iterator                                itt;
-    std::vector<tabular_index_type>::const_iterator idx;
+    IndexTable::const_iterator                      idx;
+
+    using is_contiguous = std::integral_constant<bool, std::contiguous_iterator<Iterator>>;
+
+    const typename std::iterator_traits<Iterator>::value_type& at(tabular_index_type i, std::true_type) const {
+      return std::to_address(begin)[i];
+    }
+
+    const typename std::iterator_traits<Iterator>::value_type& at(tabular_index_type i, std::false_type) const {
+      itt = begin;
+      std::advance(itt,(typename primary_type::difference_type)(i));
+      return *itt;
+    }
 
-    
 
   public:
 
@@ -88,7 +228,7 @@ namespace gaml {
     using reference         = value_type&;
     using iterator_category = std::random_access_iterator_tag;
 
-    TabularIterator(const Iterator& begin, const std::vector<tabular_index_type>::const_iterator& idx)
+    TabularIterator(const Iterator& begin, const IndexTable::const_iterator& idx)
       : begin(begin), idx(idx) {
     }
     
@@ -129,9 +269,7 @@ namespace gaml {
     bool operator!=(const TabularIterator<Iterator>& i) const {return idx != i.idx || begin != i.begin;}
     
     const typename std::iterator_traits<Iterator>::value_type& operator*() const {
-      itt = begin;
-      std::advance(itt,(typename primary_type::difference_type)(*idx));
-      return *itt;
+      return at(*idx, is_contiguous());
     }
   };
 
@@ -152,7 +290,7 @@ namespace gaml {
   class TabularBase {
   protected:
     
-    std::vector<tabular_index_type> indices;    // indices in the primary collection
+    IndexTable indices;    // indices in the primary collection
 
   public:
     
@@ -162,20 +300,22 @@ namespace gaml {
     TabularBase<Iterator>& operator=(const TabularBase<Iterator>&) = default;
     TabularBase<Iterator>& operator=(TabularBase<Iterator>&&) = default;
 
-    typedef std::vector<tabular_index_type>::const_iterator index_iterator;
+    typedef IndexTable::const_iterator index_iterator;
     index_iterator begin_index() const {return indices.begin();}
     index_iterator end_index()   const {return indices.end();}
 
+    /**
+     * This is done in constant time.
+     */
     bool has(tabular_index_type idx) const {
-      for(auto i : indices) if(i == idx) return true;
-      return false;
+      return indices.has(idx);
     }
 
     /**
      * @returns a vector of indices. They are the one mapping the
      * current iteration order to the primary collection order.
      */
-    const std::vector<tabular_index_type>& index_table() const {return indices;}
+    std::vector<tabular_index_type> index_table() const {return indices.to_vector();}
   };
 
   
@@ -199,7 +339,9 @@ namespace gaml {
     template<typename InitIdxFunc>
     Tabular(const Iterator& begin, const InitIdxFunc& init)
       : TabularBase<Iterator>(), start(begin) {
-      init(this->indices);
+      std::vector<tabular_index_type> indices;
+      init(indices);
+      this->indices = IndexTable(std::move(indices));
     }
 
     typedef TabularIterator<Iterator> iterator;
@@ -209,7 +351,11 @@ namespace gaml {
   };
   
   /**
-   * Class for tabular acces to data for secondary iterators
+   * Class for tabular acces to data for secondary iterators. The
+   * index table is composed with the one of the secondary iterators
+   * at construction, so that the iterators of nested views (a
+   * shuffle of a split of a bootstrap...) only go through a single
+   * table, against the primary collection.
    */
   template<typename Iterator> 
   class Tabular<Iterator, std::true_type> : public TabularBase<Iterator> {
@@ -228,12 +374,14 @@ namespace gaml {
     template<typename InitIdxFunc>
     Tabular(const Iterator& begin, const InitIdxFunc& init)
       : TabularBase<Iterator>(), start(begin.origin()) {
-      init(this->indices);
-      for(auto& index : this->indices) {
+      std::vector<tabular_index_type> indices;
+      init(indices);
+      for(auto& index : indices) {
 	auto sec_it = begin;
 	std::advance(sec_it,index);
 	index = sec_it.index();
       }
+      this->indices = IndexTable(std::move(indices));
     }
 
     typedef TabularIterator<typename Iterator::primary_type> iterator;
@@ -29,9 +29,29 @@
 #include <type_traits>
 #include <tuple>
 #include <optional>
+#include <cstddef>
 
 namespace gaml {
 
+  namespace internal {
+
+    /**
+     * This is the strongest iterator category that a combination of
+     * iterators of the given categories can provide, i.e. the weakest
+     * of them.
+     */
+    template<typename... Categories> struct weakest_category;
+
+    template<typename Category>
+    struct weakest_category<Category> {
+      using type = Category;
+    };
+
+    template<typename Category1, typename Category2, typename... Categories>
+    struct weakest_category<Category1, Category2, Categories...>
+      : weakest_category<std::conditional_t<std::is_base_of_v<Category1, Category2>, Category1, Category2>, Categories...> {};
+  }
+
   template<typename T>
   struct Range {
     using value_type = typename std::iterator_traits<T>::value_type;
@@ -64,7 +84,8 @@ namespace gaml {
     using value_type = decltype(std::tuple_cat(std::declval<std::tuple<typename Head::value_type>>(), *tail)); // const typename Head::value_type& generates bad memory read.
     using pointer           = value_type*;
     using reference         = value_type&;
-    using iterator_category = std::random_access_iterator_tag;
+    using iterator_category = typename internal::weakest_category<typename std::iterator_traits<typename Head::iterator_type>::iterator_category,
+								  typename ZipIterator<Tail...>::iterator_category>::type;
 
   private:
 
@@ -89,8 +110,10 @@ namespace gaml {
       if(!value)
 	value = std::tuple_cat(std::tuple<typename Head::value_type>(*head), *tail);
       return value.value();} 
+    value_type operator[](difference_type i) const {return *(*this + i);}
     bool operator==(const ZipIterator& i) const {return (head == i.head) && (tail == i.tail);}
     bool operator!=(const ZipIterator& i) const {return (head != i.head) || (tail != i.tail);}
+    bool operator< (const ZipIterator& i) const {return head < i.head;}
   };
 
   template<>
@@ -147,8 +170,13 @@ namespace gaml {
     ZipIterator<Head, Tail...> end() const {
       return ZipIterator<Head, Tail...>(end_, tail.end());
     } 
-    
 
+    /**
+     * This is O(1) if the first collection is a random access one.
+     */
+    std::size_t size() const {
+      return std::distance(begin_, end_);
+    }
   };
 
   template<>
@@ -168,9 +196,11 @@ namespace gaml {
   };
 
   /**
-   * This zips collections. <b>Warning : </b> For the sake of
-   * efficiency, if one of the iteratrors to be zipped is a random
-   * access iterator, put it first.
+   * This zips collections. The zip iterators are of the weakest
+   * category of the zipped iterators (they are random access
+   * iterators if all the zipped ones are). <b>Warning : </b> For the
+   * sake of efficiency, if one of the iteratrors to be zipped is a
+   * random access iterator, put it first.
    */
   template<typename... T>
   Zip<T...> zip(T&&... args) {